@@ -0,0 +1,84 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<uint64_t> g_allocations(0);
+	std::atomic<uint64_t> g_bytes(0);
+
+	void* countedAlloc(size_t size)
+	{
+		g_allocations.fetch_add(1, std::memory_order_relaxed);
+		g_bytes.fetch_add(size, std::memory_order_relaxed);
+		return std::malloc(size ? size : 1);
+	}
+}
+
+uint64_t AllocationCounter::allocations()
+{
+	return g_allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::bytes()
+{
+	return g_bytes.load(std::memory_order_relaxed);
+}
+
+// Replacements for the global allocation functions, everything else in the standard
+// library funnels into these
+void* operator new(size_t size)
+{
+	void* p = countedAlloc(size);
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts every call to the global operator new, so we can check how much the
+// game allocates per frame. The counting operators are defined in AllocationCounter.cpp.
+class AllocationCounter
+{
+public:
+	// Allocations and bytes requested since the program started
+	static uint64_t allocations();
+	static uint64_t bytes();
+};
\ No newline at end of file
@@ -0,0 +1,413 @@
+#include "Benchmark.h"
+#include "AllocationCounter.h"
+#include "Game.h"
+#include "Narrowphase.h"
+#include "SpatialHash.h"
+#include "Vec2.h"
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Average nanoseconds per call of fn, repeated until at least ~50ms have passed
+	template <typename F>
+	double timeNs(F&& fn)
+	{
+		size_t iterations = 0;
+		auto start = Clock::now();
+		auto elapsed = Clock::duration::zero();
+		do
+		{
+			fn();
+			iterations++;
+			elapsed = Clock::now() - start;
+		} while (elapsed < std::chrono::milliseconds(50));
+
+		return std::chrono::duration<double, std::nano>(elapsed).count() / (double)iterations;
+	}
+
+	struct Circles
+	{
+		std::vector<float> x, y, r;
+
+		void fill(size_t n, float radius, std::mt19937& rng)
+		{
+			std::uniform_real_distribution<float> px(0.0f, 1280.0f), py(0.0f, 720.0f);
+			x.resize(n); y.resize(n); r.assign(n, radius);
+			for (size_t i = 0; i < n; i++)
+			{
+				x[i] = px(rng);
+				y[i] = py(rng);
+			}
+		}
+	};
+}
+
+Benchmark::Benchmark(const std::string& config, size_t maxEntities)
+	: m_config(config), m_maxEntities(maxEntities) {}
+
+bool Benchmark::run(const std::string& name, const std::string& outputPath)
+{
+	bool all = name == "all";
+	bool found = false;
+
+	if (all || name == "systems")
+	{
+		systems();
+		found = true;
+	}
+
+	if (all || name == "collision")
+	{
+		collision();
+		found = true;
+	}
+
+	if (all || name == "iteration")
+	{
+		iteration();
+		found = true;
+	}
+
+	if (!found)
+	{
+		std::cerr << "Unknown benchmark: " << name << std::endl;
+		return false;
+	}
+	return writeJson(outputPath);
+}
+
+// Fill the game with count entities in the same mix as a busy late game: half permanent enemies,
+// a bit under half short lived fragments, and some bullets. Positions are spread over the arena.
+void Benchmark::populate(Game& game, size_t count)
+{
+	EntityManager& entities = game.m_entities;
+	const EnemyConfig& enemy = game.m_enemyConfig;
+	const BulletConfig& bullet = game.m_bulletConfig;
+	size_t total = entities.size();
+
+	for (size_t i = total; i < count; i++)
+	{
+		int kind = game.randInRange(0, 19);
+		if (kind >= 10)
+		{
+			game.spawnEnemy();
+			continue;
+		}
+
+		Vec2 pos((float)game.randInRange(0, (int)game.m_arenaSize.x), (float)game.randInRange(0, (int)game.m_arenaSize.y));
+		Vec2 velocity = Vec2::fromAngleAndSpeed((float)game.randInRange(0, 359) * 3.1415926f / 180.0f, enemy.SMAX);
+		if (kind == 0)
+		{
+			auto e = entities.addEntity(Tag::Bullet);
+			entities.addComponent(e, CTransform(pos, velocity * (bullet.S / enemy.SMAX), 0));
+			entities.addComponent<CShape>(e).set(game.m_shapes.intern(bullet.V, bullet.SR, bullet.OT),
+				sf::Color(bullet.FR, bullet.FG, bullet.FB), sf::Color(bullet.OR, bullet.OG, bullet.OB));
+			entities.addComponent(e, CCollision(bullet.CR));
+			game.addLifespan(e, bullet.L);
+		}
+		else
+		{
+			int vertices = game.randInRange(enemy.VMIN, enemy.VMAX);
+			auto e = entities.addEntity(Tag::Enemy);
+			entities.addComponent(e, CTransform(pos, velocity, 0));
+			entities.transforms().bounceRadius[entities.row(e)] = enemy.SR / 2;
+			entities.addComponent<CShape>(e).set(game.m_shapes.intern(vertices, enemy.SR / 2, enemy.OT),
+				sf::Color(255, 0, 0), sf::Color(enemy.OR, enemy.OG, enemy.OB));
+			entities.addComponent(e, CCollision(enemy.CR / 2));
+			game.addLifespan(e, enemy.L);
+			entities.addComponent(e, CScore(200 * vertices));
+		}
+	}
+}
+
+// Runs each system on worlds of 100 to m_maxEntities entities, topping the world back up
+// every frame so the population stays put while bullets and fragments expire
+void Benchmark::systems()
+{
+	struct Timed { const char* name; double ns = 0; uint64_t allocations = 0; };
+
+	LaunchOptions options;
+	options.headless = true;
+	options.seed = 1;
+
+	std::printf("%10s %8s %-18s %14s %12s %14s\n", "entities", "frames", "system", "ns/frame", "ns/entity", "allocs/frame");
+	for (size_t n = 100; n <= m_maxEntities; n *= 10)
+	{
+		Game game(m_config, options);
+
+		// Grow the arena with the population so the density, and so the collision load, stays realistic
+		float side = std::sqrt((float)n * 40000.0f);
+		game.m_arenaSize = Vec2(side, side);
+		game.m_entities.update();
+		game.m_entities.transforms().teleport(game.m_entities.row(game.m_player), game.m_arenaSize / 2);
+
+		int frames = (int)(10000000 / n);
+		frames = frames < 10 ? 10 : (frames > 1000 ? 1000 : frames);
+
+		Timed timed[6] = { { "update" }, { "sMovement" }, { "sCollision" }, { "sResolveCollisions" }, { "sTimers" }, { "renderPrep" } };
+		auto measure = [](Timed& t, auto&& fn)
+		{
+			uint64_t allocations = AllocationCounter::allocations();
+			auto start = Clock::now();
+			fn();
+			t.ns += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+			t.allocations += AllocationCounter::allocations() - allocations;
+		};
+
+		for (int f = 0; f < frames; f++)
+		{
+			populate(game, n);
+			measure(timed[0], [&]() { game.m_entities.update(); });
+			measure(timed[1], [&]() { game.sMovement(); });
+			measure(timed[2], [&]() { game.sCollision(); });
+			measure(timed[3], [&]() { game.sResolveCollisions(); });
+			measure(timed[4], [&]() { game.sTimers(); });
+			measure(timed[5], [&]() { game.updateCamera(1.0f); game.buildShapeBatch(1.0f); });
+			game.m_currentFrame++;
+		}
+
+		for (const Timed& t : timed)
+		{
+			Result result;
+			result.benchmark = "systems";
+			result.system = t.name;
+			result.entities = n;
+			result.frames = frames;
+			result.nsPerFrame = t.ns / frames;
+			result.allocationsPerFrame = (double)t.allocations / frames;
+			m_results.push_back(result);
+
+			std::printf("%10zu %8d %-18s %14.0f %12.2f %14.2f\n", n, frames, t.name, result.nsPerFrame,
+				result.nsPerFrame / n, result.allocationsPerFrame);
+		}
+	}
+}
+
+void Benchmark::collision()
+{
+	// Enemies and projectiles scattered over a 1280x720 arena with the default config radii.
+	// Every loop counts hits so the work can't be optimised away, and they must all agree.
+	std::mt19937 rng(1234);
+	SpatialHash grid(64.0f);
+	Circles enemies, projectiles;
+	int crossover = -1;
+
+	std::printf("%10s %12s %14s %14s %14s %8s\n", "enemies", "projectiles", "brute ns", "batched ns", "grid ns", "hits");
+	for (int n = 4; n <= 16384; n *= 2)
+	{
+		int m = n / 4 > 1 ? n / 4 : 1;
+		enemies.fill(n, 32.0f, rng);
+		projectiles.fill(m, 10.0f, rng);
+
+		int bruteHits = 0, batchedHits = 0, gridHits = 0;
+		double brute = timeNs([&]()
+		{
+			bruteHits = 0;
+			for (int e = 0; e < n; e++)
+			{
+				Vec2 enemyPos(enemies.x[e], enemies.y[e]);
+				for (int p = 0; p < m; p++)
+				{
+					if (Vec2(projectiles.x[p], projectiles.y[p]).dist(enemyPos) < projectiles.r[p] + enemies.r[e])
+					{
+						bruteHits++;
+					}
+				}
+			}
+		});
+
+		double batched = timeNs([&]()
+		{
+			// Every projectile against every enemy, a narrowphase batch at a time
+			batchedHits = 0;
+			for (int p = 0; p < m; p++)
+			{
+				for (int e = 0; e < n; e += (int)Narrowphase::BATCH)
+				{
+					size_t count = std::min(Narrowphase::BATCH, (size_t)(n - e));
+					uint64_t hits = Narrowphase::overlaps(projectiles.x[p], projectiles.y[p], projectiles.r[p],
+						&enemies.x[e], &enemies.y[e], &enemies.r[e], count);
+					batchedHits += (int)std::bitset<64>(hits).count();
+				}
+			}
+		});
+
+		double hashed = timeNs([&]()
+		{
+			gridHits = 0;
+			grid.rebuild(enemies.x.data(), enemies.y.data(), enemies.r.data(), n);
+			for (int p = 0; p < m; p++)
+			{
+				Vec2 projectilePos(projectiles.x[p], projectiles.y[p]);
+				grid.query(projectiles.x[p], projectiles.y[p], projectiles.r[p], [&](uint32_t e)
+				{
+					float reach = projectiles.r[p] + enemies.r[e];
+					if (projectilePos.distSq(Vec2(enemies.x[e], enemies.y[e])) < reach * reach)
+					{
+						gridHits++;
+					}
+				});
+			}
+		});
+
+		if (bruteHits != batchedHits)
+		{
+			std::cerr << "Narrowphase disagrees: " << bruteHits << " != " << batchedHits << std::endl;
+		}
+		if (bruteHits != gridHits)
+		{
+			std::cerr << "Broadphase missed a hit: " << bruteHits << " != " << gridHits << std::endl;
+		}
+		if (crossover < 0 && hashed < brute)
+		{
+			crossover = n;
+		}
+		std::printf("%10d %12d %14.0f %14.0f %14.0f %8d\n", n, m, brute, batched, hashed, gridHits);
+
+		Result result;
+		result.benchmark = "collision";
+		result.entities = n + m;
+		result.system = "bruteForce";
+		result.nsPerFrame = brute;
+		m_results.push_back(result);
+		result.system = "narrowphase";
+		result.nsPerFrame = batched;
+		m_results.push_back(result);
+		result.system = "spatialHash";
+		result.nsPerFrame = hashed;
+		m_results.push_back(result);
+	}
+
+	if (crossover > 0)
+	{
+		std::printf("Spatial hash is faster from %d enemies\n", crossover);
+	}
+	else
+	{
+		std::printf("Spatial hash never overtook the brute force loop\n");
+	}
+}
+
+// Reads every enemy's position the ways a system can get at it: a handle per enemy looked up in
+// the slot map, the enemy bucket's rows, and a component view over every row. For comparison,
+// the same loop over a vector of shared_ptrs copied per element, like the systems used to
+// iterate, which costs an atomic increment and decrement per entity.
+void Benchmark::iteration()
+{
+	LaunchOptions options;
+	options.headless = true;
+	options.seed = 1;
+	volatile float sink = 0;
+
+	std::printf("%10s %10s %-14s %14s %12s\n", "entities", "enemies", "loop", "ns/pass", "ns/enemy");
+	for (size_t n = 1000; n <= m_maxEntities; n *= 10)
+	{
+		Game game(m_config, options);
+		float side = std::sqrt((float)n * 40000.0f);
+		game.m_arenaSize = Vec2(side, side);
+		populate(game, n);
+		game.m_entities.update();
+
+		EntityManager& entities = game.m_entities;
+		TransformPool& tf = entities.transforms();
+		const EntityVec& enemies = entities.getEntities(Tag::Enemy);
+		std::vector<std::shared_ptr<Vec2>> shared;
+		shared.reserve(enemies.size());
+		for (uint32_t row : entities.rows(Tag::Enemy))
+		{
+			shared.push_back(std::make_shared<Vec2>(tf.pos(row)));
+		}
+
+		struct Loop { const char* name; double ns; };
+		Loop loops[4] =
+		{
+			{ "handles", timeNs([&]()
+			{
+				float sum = 0;
+				for (Entity e : enemies)
+				{
+					sum += tf.posX[entities.row(e)];
+				}
+				sink = sum;
+			}) },
+			{ "rows", timeNs([&]()
+			{
+				float sum = 0;
+				for (uint32_t row : entities.rows(Tag::Enemy))
+				{
+					sum += tf.posX[row];
+				}
+				sink = sum;
+			}) },
+			{ "view", timeNs([&]()
+			{
+				float sum = 0;
+				for (size_t row : entities.view<CTransform, CScore>())
+				{
+					sum += tf.posX[row];
+				}
+				sink = sum;
+			}) },
+			{ "sharedPtrCopy", timeNs([&]()
+			{
+				float sum = 0;
+				for (auto p : shared)
+				{
+					sum += p->x;
+				}
+				sink = sum;
+			}) },
+		};
+
+		for (const Loop& loop : loops)
+		{
+			Result result;
+			result.benchmark = "iteration";
+			result.system = loop.name;
+			result.entities = n;
+			result.frames = 1;
+			result.nsPerFrame = loop.ns;
+			m_results.push_back(result);
+
+			std::printf("%10zu %10zu %-14s %14.0f %12.3f\n", n, enemies.size(), loop.name, loop.ns,
+				enemies.empty() ? 0.0 : loop.ns / enemies.size());
+		}
+	}
+	(void)sink;
+}
+
+bool Benchmark::writeJson(const std::string& path) const
+{
+	std::ofstream fout(path);
+	if (!fout)
+	{
+		std::cerr << "Could not write benchmark results to " << path << std::endl;
+		return false;
+	}
+
+	fout << "[\n";
+	for (size_t i = 0; i < m_results.size(); i++)
+	{
+		const Result& r = m_results[i];
+		fout << "  {\"benchmark\": \"" << r.benchmark << "\", \"system\": \"" << r.system << "\", \"entities\": " << r.entities
+			<< ", \"frames\": " << r.frames << ", \"ns_per_frame\": " << r.nsPerFrame
+			<< ", \"ns_per_entity\": " << (r.entities ? r.nsPerFrame / r.entities : 0)
+			<< ", \"allocations_per_frame\": " << r.allocationsPerFrame << "}"
+			<< (i + 1 < m_results.size() ? ",\n" : "\n");
+	}
+	fout << "]\n";
+
+	std::cout << "Wrote " << m_results.size() << " results to " << path << std::endl;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class Game;
+
+// Timing harnesses that run without a window, started with "--bench <name>" on the command line.
+// Results are printed as a table and also written to a JSON file for tracking regressions.
+class Benchmark
+{
+	struct Result
+	{
+		std::string benchmark;
+		std::string system;
+		size_t entities = 0;
+		int frames = 0;
+		double nsPerFrame = 0;
+		double allocationsPerFrame = 0;
+	};
+
+	std::string m_config;
+	size_t m_maxEntities;
+	std::vector<Result> m_results;
+
+	void collision();
+	void systems();
+	void iteration();
+
+	void populate(Game& game, size_t count);
+	bool writeJson(const std::string& path) const;
+
+public:
+	Benchmark(const std::string& config, size_t maxEntities = 1000000);
+
+	// Runs the named benchmark ("systems", "collision", "iteration"), or all of them for "all",
+	// then writes every result to outputPath. Returns false for an unknown name.
+	bool run(const std::string& name, const std::string& outputPath);
+};
\ No newline at end of file
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "ShapeCache.h"
 #include "Vec2.h"
 #include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
 
 class CTransform
 {
@@ -15,23 +19,103 @@ public:
 
 };
 
-class CShape
+// Transforms are the hottest data in the game, so the EntityManager keeps them as
+// packed float arrays rather than CTransform objects. CTransform is only used to
+// hand a starting transform to EntityManager::addComponent.
+class TransformPool
 {
 public:
-	sf::CircleShape circle;
+	std::vector<float> posX;
+	std::vector<float> posY;
+	std::vector<float> velX;
+	std::vector<float> velY;
+	std::vector<float> angle;
+
+	// Radius an entity keeps inside the arena with, bouncing off the edges. Negative for
+	// entities that don't bounce, which is the default.
+	std::vector<float> bounceRadius;
+
+	// Positions as of the start of the current tick, so rendering can interpolate
+	std::vector<float> prevX;
+	std::vector<float> prevY;
+
+	size_t size() const { return posX.size(); }
 
-	CShape(float radius, int points, const sf::Color& fill, const sf::Color& outline, float thickness)
-		: circle(radius, points)
+	void resize(size_t n)
 	{
-		circle.setFillColor(fill);
-		circle.setOutlineColor(outline);
-		circle.setOutlineThickness(thickness);
-		circle.setOrigin(radius, radius);
+		posX.resize(n);
+		posY.resize(n);
+		velX.resize(n);
+		velY.resize(n);
+		angle.resize(n);
+		bounceRadius.resize(n);
+		prevX.resize(n);
+		prevY.resize(n);
 	}
 
-	CShape(sf::CircleShape inCircle)
+	void set(size_t i, const CTransform& t)
 	{
-		circle = inCircle;
+		posX[i] = t.pos.x;
+		posY[i] = t.pos.y;
+		velX[i] = t.velocity.x;
+		velY[i] = t.velocity.y;
+		angle[i] = t.angle;
+		bounceRadius[i] = -1.0f;
+		prevX[i] = t.pos.x;
+		prevY[i] = t.pos.y;
+	}
+
+	void move(size_t from, size_t to)
+	{
+		posX[to] = posX[from];
+		posY[to] = posY[from];
+		velX[to] = velX[from];
+		velY[to] = velY[from];
+		angle[to] = angle[from];
+		bounceRadius[to] = bounceRadius[from];
+		prevX[to] = prevX[from];
+		prevY[to] = prevY[from];
+	}
+
+	// Remember the first n rows' positions as the previous tick's, called before moving anything
+	void storePrevious(size_t n)
+	{
+		std::copy_n(posX.begin(), n, prevX.begin());
+		std::copy_n(posY.begin(), n, prevY.begin());
+	}
+
+	// Convenience accessors for code that isn't iterating the arrays
+	Vec2 pos(size_t i) const { return Vec2(posX[i], posY[i]); }
+	Vec2 velocity(size_t i) const { return Vec2(velX[i], velY[i]); }
+	void setPos(size_t i, const Vec2& p) { posX[i] = p.x; posY[i] = p.y; }
+
+	// Move without interpolating from the old position, for respawns
+	void teleport(size_t i, const Vec2& p) { setPos(i, p); prevX[i] = p.x; prevY[i] = p.y; }
+	void setVelocity(size_t i, const Vec2& v) { velX[i] = v.x; velY[i] = v.y; }
+};
+
+// Which cached geometry to draw, and how. Everything else about the shape lives in
+// the Game's ShapeCache, shared with every other entity of the same shape.
+class CShape
+{
+public:
+	ShapeCache::Id geometry = 0;
+	float scale = 1.0f;
+	sf::Color fill;
+	sf::Color outline;
+
+	CShape(ShapeCache::Id g, const sf::Color& f, const sf::Color& o)
+		: geometry(g), fill(f), outline(o) {}
+
+	CShape() {}
+
+	// Reconfigures the shape in place, for pooled rows being reused
+	void set(ShapeCache::Id g, const sf::Color& f, const sf::Color& o)
+	{
+		geometry = g;
+		scale = 1.0f;
+		fill = f;
+		outline = o;
 	}
 };
 
@@ -41,6 +125,7 @@ public:
 	float radius = 0;
 	CCollision(float r)
 		: radius(r) {}
+	CCollision() {}
 };
 
 class CInput
@@ -61,13 +146,43 @@ public:
 	int score = 0;
 	CScore(int s)
 		: score(s) {}
+	CScore() {}
 };
 
 class CLifespan
 {
 public:
-	int remaining = 0;
+	int expires = 0; // the tick the entity is gone by
 	int total = 0;
-	CLifespan(int total)
-		: remaining(total), total(total) {}
+	CLifespan(int total, int now)
+		: expires(now + total), total(total) {}
+	CLifespan() {}
+
+	// Nothing counts down, a timer destroys the entity when it's up. Everything else
+	// about the lifespan is worked out from the current tick when it's needed.
+	int remaining(int now) const { return expires - now; }
+
+	// How much of the lifespan is left, 1 when it starts and 0 when it's up
+	float ratio(int now) const
+	{
+		const int left = remaining(now);
+		return left > 0 ? (float)left / (float)total : 0.0f;
+	}
+
+	// Entities fade out as their time runs out
+	uint8_t alpha(int now) const { return (uint8_t)(255 * ratio(now)); }
+
+	// Special weapons target getting 3x bigger than their original size,
+	// and linearly achieve that scale over the lifespan
+	float growth(int now) const { return 1 + (2 * (1 - ratio(now))); }
 };
+
+// One bit per component type, used by the EntityManager to track which rows
+// actually have a given component
+template <typename T> constexpr uint8_t componentBit = 0;
+template <> constexpr uint8_t componentBit<CTransform> = 1 << 0;
+template <> constexpr uint8_t componentBit<CShape> = 1 << 1;
+template <> constexpr uint8_t componentBit<CCollision> = 1 << 2;
+template <> constexpr uint8_t componentBit<CInput> = 1 << 3;
+template <> constexpr uint8_t componentBit<CScore> = 1 << 4;
+template <> constexpr uint8_t componentBit<CLifespan> = 1 << 5;
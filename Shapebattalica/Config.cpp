@@ -0,0 +1,307 @@
+#include "Config.h"
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// One value on a directive's line, checked against [min, max]
+	struct Field
+	{
+		const char* name;
+		int* i = nullptr;
+		float* f = nullptr;
+		std::string* s = nullptr;
+		double min = 0;
+		double max = 0;
+	};
+
+	Field intField(const char* name, int& value, double min, double max = 1e9) { Field f; f.name = name; f.i = &value; f.min = min; f.max = max; return f; }
+	Field floatField(const char* name, float& value, double min, double max = 1e9) { Field f; f.name = name; f.f = &value; f.min = min; f.max = max; return f; }
+	Field textField(const char* name, std::string& value) { Field f; f.name = name; f.s = &value; return f; }
+
+	struct Directive
+	{
+		const char* name;
+		std::vector<Field> fields;
+		bool seen = false;
+	};
+}
+
+bool Config::load(const std::string& path)
+{
+	errors.clear();
+
+	std::ifstream fin(path, std::ios::binary);
+	if (!fin)
+	{
+		errors.push_back(path + ": could not open the config file");
+		return false;
+	}
+	std::stringstream contents;
+	contents << fin.rdbuf();
+	const std::string text = contents.str();
+
+	int headlessTicksValue = 0;
+	const int COLOR = 255;
+	std::vector<Directive> directives =
+	{
+		{ "Window", { intField("width", window.width, 1), intField("height", window.height, 1),
+			intField("frame rate limit", window.frameRateLimit, 0), intField("fullscreen", window.fullscreen, 0, 1) } },
+		{ "Arena", { intField("width", arena.width, 1), intField("height", arena.height, 1) } },
+		{ "Simulation", { intField("tick rate", tickRate, 4), intField("max ticks per frame", maxTicksPerFrame, 1) } },
+		{ "Pool", { intField("entities", poolSize, 0, 1 << 20) } },
+		{ "Threads", { intField("threads", threads, 0, 256) } },
+		{ "StableOrder", { intField("stable", stableOrder, 0, 1) } },
+		{ "SpecialCooldown", { intField("ticks", specialCooldown, 0) } },
+		{ "Headless", { intField("ticks", headlessTicksValue, 0) } },
+		{ "Font", { textField("path", font.path), intField("size", font.size, 1),
+			intField("red", font.r, 0, COLOR), intField("green", font.g, 0, COLOR), intField("blue", font.b, 0, COLOR) } },
+		{ "Player", { intField("SR", player.SR, 1), intField("CR", player.CR, 1), floatField("S", player.S, 0),
+			intField("FR", player.FR, 0, COLOR), intField("FG", player.FG, 0, COLOR), intField("FB", player.FB, 0, COLOR),
+			intField("OR", player.OR, 0, COLOR), intField("OG", player.OG, 0, COLOR), intField("OB", player.OB, 0, COLOR),
+			intField("OT", player.OT, 0), intField("V", player.V, 3, 64) } },
+		{ "Enemy", { intField("SR", enemy.SR, 1), intField("CR", enemy.CR, 1), floatField("SMIN", enemy.SMIN, 0), floatField("SMAX", enemy.SMAX, 0),
+			intField("OR", enemy.OR, 0, COLOR), intField("OG", enemy.OG, 0, COLOR), intField("OB", enemy.OB, 0, COLOR),
+			intField("OT", enemy.OT, 0), intField("VMIN", enemy.VMIN, 3, 64), intField("VMAX", enemy.VMAX, 3, 64),
+			intField("L", enemy.L, 1), intField("SI", enemy.SI, 1) } },
+		{ "Bullet", { intField("SR", bullet.SR, 1), intField("CR", bullet.CR, 1), floatField("S", bullet.S, 0),
+			intField("FR", bullet.FR, 0, COLOR), intField("FG", bullet.FG, 0, COLOR), intField("FB", bullet.FB, 0, COLOR),
+			intField("OR", bullet.OR, 0, COLOR), intField("OG", bullet.OG, 0, COLOR), intField("OB", bullet.OB, 0, COLOR),
+			intField("OT", bullet.OT, 0), intField("V", bullet.V, 3, 64), intField("L", bullet.L, 1) } },
+	};
+	auto find = [&](const std::string& name) -> Directive*
+	{
+		for (Directive& d : directives)
+		{
+			if (name == d.name)
+			{
+				return &d;
+			}
+		}
+		return nullptr;
+	};
+
+	// One directive per line, its values separated by whitespace. Blank lines and anything after # are ignored.
+	std::vector<std::string> tokens;
+	size_t lineStart = 0;
+	for (int lineNumber = 1; lineStart < text.size(); lineNumber++)
+	{
+		size_t lineEnd = text.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+		{
+			lineEnd = text.size();
+		}
+		std::string line = text.substr(lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+
+		line = line.substr(0, line.find('#'));
+		std::istringstream words(line);
+		tokens.clear();
+		for (std::string word; words >> word; )
+		{
+			tokens.push_back(word);
+		}
+		if (tokens.empty())
+		{
+			continue;
+		}
+
+		const std::string where = path + ":" + std::to_string(lineNumber) + ": ";
+		Directive* directive = find(tokens[0]);
+		if (!directive)
+		{
+			errors.push_back(where + "unknown directive " + tokens[0]);
+			continue;
+		}
+		if (directive->seen)
+		{
+			errors.push_back(where + tokens[0] + " appears more than once");
+		}
+		directive->seen = true;
+		if (tokens.size() - 1 != directive->fields.size())
+		{
+			errors.push_back(where + tokens[0] + " expects " + std::to_string(directive->fields.size()) + " values, found " +
+				std::to_string(tokens.size() - 1));
+			continue;
+		}
+
+		for (size_t i = 0; i < directive->fields.size(); i++)
+		{
+			const Field& field = directive->fields[i];
+			const std::string& token = tokens[i + 1];
+			if (field.s)
+			{
+				*field.s = token;
+				continue;
+			}
+
+			// The whole token has to be a number, "12px" or "1.5" for an integer is a mistake
+			char* end = nullptr;
+			errno = 0;
+			double value = field.i ? (double)std::strtol(token.c_str(), &end, 10) : std::strtod(token.c_str(), &end);
+			if (end == token.c_str() || *end != '\0' || errno == ERANGE)
+			{
+				errors.push_back(where + tokens[0] + " " + field.name + " should be " + (field.i ? "a whole number" : "a number") +
+					", got " + token);
+				continue;
+			}
+			if (value < field.min || value > field.max)
+			{
+				std::ostringstream message;
+				message << where << tokens[0] << " " << field.name << " must be ";
+				if (field.max >= 1e9)
+				{
+					message << "at least " << field.min;
+				}
+				else
+				{
+					message << "between " << field.min << " and " << field.max;
+				}
+				message << ", got " << token;
+				errors.push_back(message.str());
+				continue;
+			}
+
+			if (field.i)
+			{
+				*field.i = (int)value;
+			}
+			else
+			{
+				*field.f = (float)value;
+			}
+		}
+	}
+
+	headless = find("Headless")->seen;
+	headlessTicks = headlessTicksValue;
+
+	// Whole sections that have to be there, and values that only make sense together
+	for (const char* required : { "Window", "Player", "Enemy", "Bullet" })
+	{
+		if (!find(required)->seen)
+		{
+			errors.push_back(path + ": missing the " + required + " line");
+		}
+	}
+	if (find("Enemy")->seen)
+	{
+		if (enemy.VMIN > enemy.VMAX)
+		{
+			errors.push_back(path + ": Enemy VMIN (" + std::to_string(enemy.VMIN) + ") is more than VMAX (" + std::to_string(enemy.VMAX) + ")");
+		}
+		if (enemy.SMIN > enemy.SMAX)
+		{
+			errors.push_back(path + ": Enemy SMIN is more than SMAX");
+		}
+
+		// Enemies spawn at least SR from every edge, so the arena has to fit one, and without an Arena line it's the window
+		const int arenaWidth = arena.width > 0 ? arena.width : window.width;
+		const int arenaHeight = arena.width > 0 ? arena.height : window.height;
+		if (find("Window")->seen && (2 * enemy.SR > arenaWidth || 2 * enemy.SR > arenaHeight))
+		{
+			errors.push_back(path + ": Enemy SR (" + std::to_string(enemy.SR) + ") doesn't fit in the " + std::to_string(arenaWidth) + "x" +
+				std::to_string(arenaHeight) + " arena, it can be at most half its width and height");
+		}
+	}
+	if (!headless && !find("Font")->seen)
+	{
+		errors.push_back(path + ": missing the Font line, it's only optional with Headless");
+	}
+
+	return errors.empty();
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+#ifdef __linux__
+	if (m_fd >= 0)
+	{
+		close(m_fd);
+	}
+#endif
+}
+
+#ifdef __linux__
+bool ConfigWatcher::open(const std::string& path)
+{
+	m_path = path;
+	std::filesystem::path file(path);
+	std::string directory = file.has_parent_path() ? file.parent_path().string() : ".";
+	m_name = file.filename().string();
+
+	// Watch the directory rather than the file, editors often save by writing a new file and renaming it over the old one
+	m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_fd < 0 || inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+	{
+		return false;
+	}
+	return true;
+}
+
+bool ConfigWatcher::changed()
+{
+	if (m_fd < 0)
+	{
+		return false;
+	}
+
+	// Drain every pending event, the buffer is aligned the way inotify_event needs
+	bool changed = false;
+	alignas(inotify_event) char buffer[4096];
+	ssize_t length;
+	while ((length = read(m_fd, buffer, sizeof(buffer))) > 0)
+	{
+		for (char* p = buffer; p < buffer + length; )
+		{
+			const inotify_event* event = (const inotify_event*)p;
+			if (event->len > 0 && m_name == event->name)
+			{
+				changed = true;
+			}
+			p += sizeof(inotify_event) + event->len;
+		}
+	}
+	return changed;
+}
+#else
+static int64_t lastWriteTime(const std::string& path)
+{
+	std::error_code error;
+	auto time = std::filesystem::last_write_time(path, error);
+	return error ? 0 : (int64_t)time.time_since_epoch().count();
+}
+
+bool ConfigWatcher::open(const std::string& path)
+{
+	m_path = path;
+	m_lastWrite = lastWriteTime(path);
+	return m_lastWrite != 0;
+}
+
+bool ConfigWatcher::changed()
+{
+	// Checking the file is a system call, so only do it every so often
+	if (m_path.empty() || --m_pollCountdown > 0)
+	{
+		return false;
+	}
+	m_pollCountdown = 30;
+
+	int64_t lastWrite = lastWriteTime(m_path);
+	if (lastWrite == m_lastWrite)
+	{
+		return false;
+	}
+	m_lastWrite = lastWrite;
+	return true;
+}
+#endif
\ No newline at end of file
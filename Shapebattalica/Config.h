@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct PlayerConfig { int SR, CR, FR, FG, FB, OR, OG, OB, OT, V; float S; };
+struct EnemyConfig { int SR, CR, OR, OG, OB, OT, VMIN, VMAX, L, SI; float SMIN, SMAX; };
+struct BulletConfig { int SR, CR, FR, FG, FB, OR, OG, OB, OT, V, L; float S; };
+
+struct WindowConfig { int width = 1280, height = 720, frameRateLimit = 60, fullscreen = 0; };
+struct FontConfig { std::string path; int size = 24, r = 255, g = 255, b = 255; };
+struct ArenaConfig { int width = 0, height = 0; }; // 0 for the window's size
+
+// Everything in the config file. load() reads the whole file in one pass and checks
+// every value, so the game never starts with a missing or out of range setting.
+// Window, Player, Enemy and Bullet are required, and Font is too unless running headless.
+class Config
+{
+public:
+	WindowConfig window;
+	FontConfig font;
+	ArenaConfig arena;
+	PlayerConfig player = {};
+	EnemyConfig enemy = {};
+	BulletConfig bullet = {};
+	int tickRate = 60;
+	int maxTicksPerFrame = 5;
+	int poolSize = 4096;
+	int threads = 0;
+	int stableOrder = 0; // 1 keeps entities in spawn order, see EntityManager::setStableOrder
+	int specialCooldown = 180; // ticks the special weapon takes to recharge
+	bool headless = false; // set by a Headless line
+	long headlessTicks = 0;
+
+	// Problems found by the last load, one line each, as "path:line: message"
+	std::vector<std::string> errors;
+
+	// Returns false if the file couldn't be read or anything in it was wrong
+	bool load(const std::string& path);
+};
+
+// Notices when the config file changes, so the game can pick up new values while it runs.
+// Uses inotify on Linux, and elsewhere checks the file's modification time now and then.
+class ConfigWatcher
+{
+	std::string m_path;
+#ifdef __linux__
+	int m_fd = -1;
+	std::string m_name; // inotify watches the directory, editors often replace the file
+#else
+	int64_t m_lastWrite = 0;
+	int m_pollCountdown = 0;
+#endif
+
+public:
+	ConfigWatcher() {}
+	~ConfigWatcher();
+
+	ConfigWatcher(const ConfigWatcher&) = delete;
+	ConfigWatcher& operator = (const ConfigWatcher&) = delete;
+
+	bool open(const std::string& path);
+
+	// True once after each change, never blocks
+	bool changed();
+};
\ No newline at end of file
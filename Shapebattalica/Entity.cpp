@@ -1,24 +1,19 @@
 #include "Entity.h"
 
-Entity::Entity(const size_t id, const std::string& tag)
-	: m_id(id), m_tag(tag) {}
+Entity::Entity(uint32_t index, uint32_t generation)
+	: m_id(((generation & GENERATION_MASK) << INDEX_BITS) | (index & INDEX_MASK)) {}
 
-bool Entity::isActive() const
+uint32_t Entity::index() const
 {
-	return m_active;
+	return m_id & INDEX_MASK;
 }
 
-const std::string& Entity::tag() const
+uint32_t Entity::generation() const
 {
-	return m_tag;
+	return m_id >> INDEX_BITS;
 }
 
-const size_t Entity::id() const
+uint32_t Entity::id() const
 {
 	return m_id;
-}
-
-void Entity::destroy()
-{
-	m_active = false;
-}
+}
\ No newline at end of file
@@ -1,33 +1,45 @@
 #pragma once
 
 #include "Components.h"
-#include <memory>
-#include <string>
+#include <cstdint>
 
+// What kind of thing an entity is. Tags index EntityManager's buckets directly,
+// so a new tag only needs adding here before Count.
+enum class Tag : uint8_t
+{
+	Player,
+	Enemy,
+	Bullet,
+	SpecialWeapon,
+	Count
+};
+
+// An entity is just a 32-bit handle: the low bits index a slot in the EntityManager,
+// the high bits hold that slot's generation when the handle was made. A slot's generation
+// is bumped whenever its entity dies, so handles to dead entities can be detected as stale.
 class Entity
 {
 	friend class EntityManager;
 
-	bool m_active = true;
-	size_t m_id = 0;
-	std::string m_tag = "default";
+	uint32_t m_id = INVALID;
 
-	// constructor and destructor
-	Entity(const size_t id, const std::string& tag);
+	Entity(uint32_t index, uint32_t generation);
 
 public:
+	static constexpr uint32_t INDEX_BITS = 20;
+	static constexpr uint32_t GENERATION_BITS = 32 - INDEX_BITS;
+	static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+	static constexpr uint32_t GENERATION_MASK = (1u << GENERATION_BITS) - 1;
+	static constexpr uint32_t INVALID = 0xFFFFFFFF;
 
-	// Component pointers
-	std::shared_ptr<CTransform> cTransform;
-	std::shared_ptr<CShape> cShape;
-	std::shared_ptr<CCollision> cCollision;
-	std::shared_ptr<CInput> cInput;
-	std::shared_ptr<CScore> cScore;
-	std::shared_ptr<CLifespan> cLifespan;
+	// A default constructed handle never refers to a live entity
+	Entity() {}
 
 	// private member access functions
-	bool isActive() const;
-	const std::string& tag() const;
-	const size_t id() const;
-	void destroy();
+	uint32_t index() const;
+	uint32_t generation() const;
+	uint32_t id() const;
+
+	bool operator == (const Entity& rhs) const { return m_id == rhs.m_id; }
+	bool operator != (const Entity& rhs) const { return m_id != rhs.m_id; }
 };
\ No newline at end of file
@@ -1,58 +1,367 @@
 #include "EntityManager.h"
+#include <algorithm>
+#include <functional>
+#include <iterator>
 #include <iostream>
+#include "Random.h"
 
 EntityManager::EntityManager()
 {
 
 }
 
+void EntityManager::reserve(size_t entities)
+{
+	growRows(entities);
+	m_entities.reserve(entities);
+	m_entitiesToAdd.reserve(entities);
+	m_slotGenerations.reserve(entities);
+	m_slotRows.reserve(entities);
+	for (size_t t = 0; t < (size_t)Tag::Count; t++)
+	{
+		m_entityMap[t].reserve(entities);
+		m_bucketRows[t].reserve(entities);
+	}
+}
+
 void EntityManager::update()
 {
 	// Adds entities from m_entitiesToAdd to the proper locations
 	//	- add them to the vector of all entities
-	//	- add them to the vector inside the map, with the tag as a key
+	//	- add them to the bucket for their tag
+	// Their rows were already appended by addEntity, so they line up with m_entities
 	for (auto e : m_entitiesToAdd)
 	{
 		m_entities.push_back(e);
-		m_entityMap[e->tag()].push_back(e);
+
+		// A new tag's bucket starts out as big as the reserved entity list, so it doesn't regrow later
+		EntityVec& bucket = m_entityMap[(size_t)tag(e)];
+		RowVec& rows = m_bucketRows[(size_t)tag(e)];
+		if (bucket.capacity() == 0)
+		{
+			bucket.reserve(m_entities.capacity());
+			rows.reserve(m_entities.capacity());
+		}
+		m_bucketIndex[row(e)] = (uint32_t)bucket.size();
+		bucket.push_back(e);
+		rows.push_back((uint32_t)row(e));
 	}
 
 	m_entitiesToAdd.clear();
 
-	// remove dead entities from the vector of all entities
-	removeDeadEntities(m_entities);
+	const size_t destroyed = m_destroyedCount.load(std::memory_order_relaxed);
+	if (destroyed == 0)
+	{
+		return;
+	}
+
+	// Workers append in whatever order they finish, sorting makes the removals the same every run.
+	// Highest row first, so the last row is never one that's still waiting to be removed.
+	uint32_t* rows = m_destroyed.data();
+	std::sort(rows, rows + destroyed, std::greater<uint32_t>());
+	const size_t count = std::unique(rows, rows + destroyed) - rows;
+
+	// Buckets first, while every row still says where its entity is in its bucket
+	removeFromBuckets(rows, count);
+	removeRows(rows, count);
+	m_destroyedCount.store(0, std::memory_order_relaxed);
+}
 
-	// remove dead entities from each vector in the entity map
-	// C++17 way of iterating through [k,v] pairs in a map
-	for (auto& [tag, entityVec] : m_entityMap)
+void EntityManager::clear()
+{
+	// Free every slot, which is what makes the old handles stale. Rows are in the same order
+	// as m_entities followed by m_entitiesToAdd.
+	for (Entity e : m_entities)
+	{
+		freeSlot(e.index());
+	}
+	for (Entity e : m_entitiesToAdd)
+	{
+		freeSlot(e.index());
+	}
+	m_entities.clear();
+	m_entitiesToAdd.clear();
+	for (size_t t = 0; t < (size_t)Tag::Count; t++)
 	{
-		removeDeadEntities(entityVec);
+		m_entityMap[t].clear();
+		m_bucketRows[t].clear();
 	}
+	m_rowCount = 0;
+	m_destroyedCount.store(0, std::memory_order_relaxed);
 }
 
-void EntityManager::removeDeadEntities(EntityVec& vec)
+void EntityManager::removeFromBuckets(const uint32_t* rows, size_t count)
 {
-	// Remove all dead entities from the input vector
-	// this is called by the update() function
-	vec.erase(std::remove_if(vec.begin(), vec.end(), [](std::shared_ptr<Entity> e) { return !e->isActive(); }),
-		vec.end());
+	if (!m_stableOrder)
+	{
+		// Move each bucket's last entity into the hole
+		for (size_t i = 0; i < count; i++)
+		{
+			EntityVec& bucket = m_entityMap[(size_t)m_tags[rows[i]]];
+			RowVec& bucketRows = m_bucketRows[(size_t)m_tags[rows[i]]];
+			const uint32_t hole = m_bucketIndex[rows[i]];
+			bucket[hole] = bucket.back();
+			bucketRows[hole] = bucketRows.back();
+			m_bucketIndex[bucketRows[hole]] = hole;
+			bucket.pop_back();
+			bucketRows.pop_back();
+		}
+		return;
+	}
+
+	// Only the buckets that lost something are touched, and only from their first hole on
+	uint32_t firstHole[(size_t)Tag::Count];
+	std::fill(std::begin(firstHole), std::end(firstHole), NO_ROW);
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t& first = firstHole[(size_t)m_tags[rows[i]]];
+		first = std::min(first, m_bucketIndex[rows[i]]);
+	}
+
+	for (size_t t = 0; t < (size_t)Tag::Count; t++)
+	{
+		if (firstHole[t] == NO_ROW)
+		{
+			continue;
+		}
+
+		EntityVec& bucket = m_entityMap[t];
+		RowVec& bucketRows = m_bucketRows[t];
+		size_t write = firstHole[t];
+		for (size_t read = write; read < bucket.size(); read++)
+		{
+			const uint32_t r = bucketRows[read];
+			if (m_active[r])
+			{
+				bucket[write] = bucket[read];
+				bucketRows[write] = r;
+				m_bucketIndex[r] = (uint32_t)write;
+				write++;
+			}
+		}
+		bucket.resize(write);
+		bucketRows.resize(write);
+	}
 }
 
-std::shared_ptr<Entity> EntityManager::addEntity(const std::string& tag)
+void EntityManager::removeRows(const uint32_t* rows, size_t count)
 {
-	auto entity = std::shared_ptr<Entity>(new Entity(m_totalEntities++, tag));
+	if (!m_stableOrder)
+	{
+		// rows is highest first, so every row past the one being removed is live
+		for (size_t i = 0; i < count; i++)
+		{
+			const size_t hole = rows[i];
+			const size_t last = m_entities.size() - 1;
+			freeSlot(m_entities[hole].index());
+			if (hole != last)
+			{
+				moveRow(last, hole);
+				m_entities[hole] = m_entities[last];
+				m_slotRows[m_entities[hole].index()] = (uint32_t)hole;
+				m_bucketRows[(size_t)m_tags[hole]][m_bucketIndex[hole]] = (uint32_t)hole;
+			}
+			m_entities.pop_back();
+		}
+		m_rowCount = m_entities.size();
+		return;
+	}
+
+	// Slide the live rows after the first dead one down over the dead ones, keeping their order
+	size_t write = rows[count - 1];
+	for (size_t read = write; read < m_entities.size(); read++)
+	{
+		if (!m_active[read])
+		{
+			freeSlot(m_entities[read].index());
+			continue;
+		}
+
+		if (write != read)
+		{
+			moveRow(read, write);
+			m_entities[write] = m_entities[read];
+			m_slotRows[m_entities[write].index()] = (uint32_t)write;
+			m_bucketRows[(size_t)m_tags[write]][m_bucketIndex[write]] = (uint32_t)write;
+		}
+		write++;
+	}
+
+	m_entities.resize(write);
+	m_rowCount = write;
+}
+
+void EntityManager::setBucketOrder(Tag tag, const EntityVec& order)
+{
+	EntityVec& bucket = m_entityMap[(size_t)tag];
+	RowVec& bucketRows = m_bucketRows[(size_t)tag];
+	bucket = order;
+	bucketRows.resize(bucket.size());
+	for (size_t i = 0; i < bucket.size(); i++)
+	{
+		bucketRows[i] = (uint32_t)row(bucket[i]);
+		m_bucketIndex[bucketRows[i]] = (uint32_t)i;
+	}
+}
+
+void EntityManager::moveRow(size_t from, size_t to)
+{
+	m_active[to] = m_active[from];
+	m_tags[to] = m_tags[from];
+	m_masks[to] = m_masks[from];
+	m_bucketIndex[to] = m_bucketIndex[from];
+	m_transforms.move(from, to);
+	std::apply([from, to](auto&... pool) { ((pool[to] = pool[from]), ...); }, m_pools);
+}
+
+void EntityManager::growRows(size_t n)
+{
+	if (n <= m_masks.size())
+	{
+		return;
+	}
+
+	m_active.resize(n);
+	m_tags.resize(n);
+	m_masks.resize(n);
+	m_bucketIndex.resize(n);
+	m_destroyed.resize(n);
+	m_transforms.resize(n);
+	std::apply([n](auto&... pool) { (pool.resize(n), ...); }, m_pools);
+}
+
+uint32_t EntityManager::allocateSlot()
+{
+	// Reuse the oldest free slot if there is one, otherwise grow the slot map
+	if (m_freeHead != NO_ROW)
+	{
+		uint32_t index = m_freeHead;
+		m_freeHead = m_slotRows[index];
+		if (m_freeHead == NO_ROW)
+		{
+			m_freeTail = NO_ROW;
+		}
+		return index;
+	}
+
+	if (m_slotRows.size() > Entity::INDEX_MASK)
+	{
+		std::cerr << "Too many entities, the slot map is full" << std::endl;
+		exit(-1);
+	}
+
+	m_slotGenerations.push_back(0);
+	m_slotRows.push_back(NO_ROW);
+	return (uint32_t)(m_slotRows.size() - 1);
+}
+
+void EntityManager::freeSlot(uint32_t index)
+{
+	// Bumping the generation is what makes every outstanding handle to this slot stale
+	m_slotGenerations[index] = (m_slotGenerations[index] + 1) & Entity::GENERATION_MASK;
+
+	// Append to the tail of the free list, m_slotRows doubles as the "next" link
+	m_slotRows[index] = NO_ROW;
+	if (m_freeTail == NO_ROW)
+	{
+		m_freeHead = index;
+	}
+	else
+	{
+		m_slotRows[m_freeTail] = index;
+	}
+	m_freeTail = index;
+}
+
+Entity EntityManager::addEntity(Tag tag)
+{
+	uint32_t index = allocateSlot();
+	Entity entity(index, m_slotGenerations[index]);
+
+	// Give it a component-less row at the end of the arrays, growing them by half if they're full
+	size_t row = m_rowCount++;
+	if (m_rowCount > m_masks.size())
+	{
+		growRows(m_masks.size() + m_masks.size() / 2 + 16);
+	}
+	m_slotRows[index] = (uint32_t)row;
+	m_active[row] = 1;
+	m_tags[row] = tag;
+	m_masks[row] = 0;
 
 	m_entitiesToAdd.push_back(entity);
 	
 	return entity;
 }
 
+void EntityManager::destroy(Entity entity)
+{
+	if (isValid(entity) && m_active[row(entity)])
+	{
+		const size_t r = row(entity);
+		m_active[r] = 0;
+		m_destroyed[m_destroyedCount.fetch_add(1, std::memory_order_relaxed)] = (uint32_t)r;
+	}
+}
+
+bool EntityManager::isActive(Entity entity) const
+{
+	return isValid(entity) && m_active[row(entity)];
+}
+
+bool EntityManager::isValid(Entity entity) const
+{
+	uint32_t index = entity.index();
+	return entity.id() != Entity::INVALID && index < m_slotGenerations.size() &&
+		m_slotGenerations[index] == entity.generation();
+}
+
 const EntityVec& EntityManager::getEntities()
 {
 	return m_entities;
 }
 
-const EntityVec& EntityManager::getEntities(const std::string& tag)
+
+void EntityManager::test()
 {
-	return m_entityMap[tag];
+	for (bool stable : { false, true })
+	{
+		EntityManager entities;
+		entities.setStableOrder(stable);
+		Random rng(2468);
+		std::vector<Entity> handles;
+		int errors = 0;
+		for (int round = 0; round < 200; round++)
+		{
+			for (int i = rng.range(0, 40); i > 0; i--)
+			{
+				handles.push_back(entities.addEntity((Tag)rng.range(0, (int)Tag::Count - 1)));
+			}
+			for (int i = rng.range(0, 30); i > 0 && !handles.empty(); i--)
+			{
+				entities.destroy(handles[rng.range(0, (int)handles.size() - 1)]);
+			}
+			entities.update();
+
+			size_t bucketed = 0;
+			for (size_t t = 0; t < (size_t)Tag::Count; t++)
+			{
+				const EntityVec& bucket = entities.getEntities((Tag)t);
+				const RowVec& rows = entities.rows((Tag)t);
+				errors += bucket.size() != rows.size();
+				for (size_t i = 0; i < bucket.size() && i < rows.size(); i++)
+				{
+					errors += !entities.isActive(bucket[i]) || entities.row(bucket[i]) != rows[i] ||
+						entities.tag(rows[i]) != (Tag)t || entities.m_entities[rows[i]] != bucket[i];
+				}
+				bucketed += bucket.size();
+			}
+			errors += bucketed != entities.size();
+			for (size_t r = 0; r < entities.size(); r++)
+			{
+				errors += entities.row(entities.m_entities[r]) != r;
+			}
+		}
+		std::cout << "EntityManager " << (stable ? "stable" : "swap and pop") << " mismatches: " << errors << " == 0" << std::endl;
+	}
 }
\ No newline at end of file
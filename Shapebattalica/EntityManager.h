@@ -2,27 +2,200 @@
 
 #include "Entity.h"
 #include <vector>
-#include <map>
+#include <array>
+#include <atomic>
+#include <tuple>
 
-typedef std::vector<std::shared_ptr<Entity>> EntityVec;
-typedef std::map<std::string, EntityVec> EntityMap;
+typedef std::vector<Entity> EntityVec;
+typedef std::array<EntityVec, (size_t)Tag::Count> EntityMap;
+typedef std::vector<uint32_t> RowVec;
+
+// Iterates the rows of the live entities that have every component in the mask
+class EntityView
+{
+	const uint8_t* m_masks;
+	size_t m_count;
+	uint8_t m_required;
+
+public:
+	class iterator
+	{
+		const EntityView* m_view;
+		size_t m_row;
+
+	public:
+		iterator(const EntityView* view, size_t row)
+			: m_view(view), m_row(row) { skip(); }
+
+		void skip()
+		{
+			while (m_row < m_view->m_count && (m_view->m_masks[m_row] & m_view->m_required) != m_view->m_required)
+			{
+				m_row++;
+			}
+		}
+
+		size_t operator * () const { return m_row; }
+		iterator& operator ++ () { m_row++; skip(); return *this; }
+		bool operator != (const iterator& rhs) const { return m_row != rhs.m_row; }
+	};
+
+	EntityView(const uint8_t* masks, size_t count, uint8_t required)
+		: m_masks(masks), m_count(count), m_required(required) {}
+
+	iterator begin() const { return iterator(this, 0); }
+	iterator end() const { return iterator(this, m_count); }
+};
 
 class EntityManager
 {
+	static constexpr uint32_t NO_ROW = 0xFFFFFFFF;
+
+	// Every entity owns one row in each of the component arrays below.
+	// Rows [0, m_entities.size()) belong to live entities, in the same order as m_entities,
+	// and the rows up to m_rowCount belong to the entities still waiting in m_entitiesToAdd.
+	// The arrays themselves never shrink, so rows past m_rowCount are spare, already
+	// constructed components that new entities reuse without allocating.
 	EntityVec m_entities;
 	EntityVec m_entitiesToAdd;
 	EntityMap m_entityMap;
-	size_t m_totalEntities = 0;
+	std::array<RowVec, (size_t)Tag::Count> m_bucketRows; // each bucket's entities' rows, in bucket order
+
+	// Slot map from handle index to row. Free slots are chained into a FIFO list through
+	// m_slotRows, so a slot is reused as late as possible and its generation wraps slowly.
+	std::vector<uint32_t> m_slotGenerations;
+	std::vector<uint32_t> m_slotRows;
+	uint32_t m_freeHead = NO_ROW;
+	uint32_t m_freeTail = NO_ROW;
+
+	// Per row data that isn't a component
+	std::vector<uint8_t> m_active;
+	std::vector<Tag> m_tags;
+	std::vector<uint8_t> m_masks;
+	std::vector<uint32_t> m_bucketIndex; // where each row's entity is in its tag's bucket
+	size_t m_rowCount = 0;
+	TransformPool m_transforms;
+	std::tuple<std::vector<CShape>, std::vector<CCollision>, std::vector<CInput>,
+		std::vector<CScore>, std::vector<CLifespan>> m_pools;
+
+	// Rows destroyed since the last update, so removing them costs O(dead) rather than a pass
+	// over every entity. Sized like the row arrays and appended to from any thread, each row
+	// is only ever destroyed from one thread at a time.
+	std::vector<uint32_t> m_destroyed;
+	std::atomic<size_t> m_destroyedCount{ 0 };
+
+	// Keep rows and buckets in spawn order, instead of filling holes from the end
+	bool m_stableOrder = false;
 
-	void removeDeadEntities(EntityVec& vec);
+	void removeFromBuckets(const uint32_t* rows, size_t count);
+	void removeRows(const uint32_t* rows, size_t count);
+	void moveRow(size_t from, size_t to);
+	void growRows(size_t n);
+	uint32_t allocateSlot();
+	void freeSlot(uint32_t index);
 
 public:
 	EntityManager();
 
+	// Preallocate storage for this many entities, so nothing allocates until there are more
+	void reserve(size_t entities);
+
+	// Adds the entities created since the last update, and removes the ones destroyed.
+	// A dead entity's row is filled by moving the last row into it, and the same goes for its
+	// place in its tag's bucket, so both are reordered but stay the same from run to run.
 	void update();
 
-	std::shared_ptr<Entity> addEntity(const std::string& tag);
+	// Keep rows and buckets in the order entities were added, e.g. so overlapping shapes
+	// always draw in the same order. Removal then slides everything after the first death down.
+	void setStableOrder(bool stable) { m_stableOrder = stable; }
+
+	// Puts a tag's bucket in the given order, for restoring a saved world. The list must hold
+	// exactly the entities already in the bucket.
+	void setBucketOrder(Tag tag, const EntityVec& order);
+
+	// Removes every entity straight away, including ones waiting to be added. Every handle goes stale.
+	void clear();
+
+	Entity addEntity(Tag tag);
+
+	// Marks the entity dead, it is removed on the next update(). Stale handles are ignored.
+	// Safe to call from the scheduler's workers, as long as each row is handled by one of them.
+	void destroy(Entity entity);
+
+	// True until the entity has been destroyed, including while it waits to be added
+	bool isActive(Entity entity) const;
+
+	// True if the handle still refers to an entity that hasn't been removed by update()
+	bool isValid(Entity entity) const;
+
+	// Row of the entity's components, the handle must be valid
+	size_t row(Entity entity) const { return m_slotRows[entity.index()]; }
+
+	Tag tag(Entity entity) const { return m_tags[row(entity)]; }
+	Tag tag(size_t row) const { return m_tags[row]; }
+
+	// The componentBits of the components the row has
+	uint8_t mask(size_t row) const { return m_masks[row]; }
 
 	const EntityVec& getEntities();
-	const EntityVec& getEntities(const std::string& tag);
-};
+	const EntityVec& getEntities(Tag tag) const { return m_entityMap[(size_t)tag]; }
+
+	// Rows of a tag's entities, lined up with getEntities(tag). Loops over a tag should use
+	// these, each handle would otherwise cost a lookup in the slot map to find its row.
+	const RowVec& rows(Tag tag) const { return m_bucketRows[(size_t)tag]; }
+
+	// Number of live rows, i.e. the valid range for the component arrays
+	size_t size() const { return m_entities.size(); }
+
+	// Rows in use, including the entities still waiting to be added
+	size_t rowCount() const { return m_rowCount; }
+
+	// False once the row's entity has been destroyed, until update() removes the row
+	bool isActive(size_t row) const { return m_active[row] != 0; }
+
+	TransformPool& transforms() { return m_transforms; }
+
+	template <typename T>
+	std::vector<T>& components() { return std::get<std::vector<T>>(m_pools); }
+
+	template <typename T>
+	bool has(size_t row) const { return (m_masks[row] & componentBit<T>) != 0; }
+
+	template <typename T>
+	T& get(size_t row) { return components<T>()[row]; }
+
+	template <typename T>
+	T& get(Entity entity) { return get<T>(row(entity)); }
+
+	template <typename T>
+	T& addComponent(Entity entity, const T& component)
+	{
+		return addComponent<T>(entity) = component;
+	}
+
+	// Adds the component without initialising it, the pooled object left over from
+	// a previous entity is returned as is and must be fully set up by the caller
+	template <typename T>
+	T& addComponent(Entity entity)
+	{
+		m_masks[row(entity)] |= componentBit<T>;
+		return components<T>()[row(entity)];
+	}
+
+	void addComponent(Entity entity, const CTransform& transform)
+	{
+		m_masks[row(entity)] |= componentBit<CTransform>;
+		m_transforms.set(row(entity), transform);
+	}
+
+	// Adds and destroys entities at random in both removal modes, checking the rows,
+	// buckets and handles all still agree after every update
+	static void test();
+
+	// All live rows that have each of the given components
+	template <typename... Ts>
+	EntityView view() const
+	{
+		return EntityView(m_masks.data(), m_entities.size(), (componentBit<Ts> | ... | 0));
+	}
+};
\ No newline at end of file
@@ -2,111 +2,375 @@
 #include <iostream>
 #include <fstream>
 #include <math.h>
-
-Game::Game(const std::string& config)
+#include <random>
+#include <algorithm>
+#include "AllocationCounter.h"
+#include "MovementKernel.h"
+#include "Narrowphase.h"
+#include "Snapshot.h"
+#include <cstdio>
+
+// Loops over fewer rows than this aren't worth splitting across threads
+static const size_t MIN_CHUNK_ROWS = 4096;
+
+Game::Game(const std::string& config, const LaunchOptions& options)
+	: m_options(options)
 {
 	init(config);
 }
 
 void Game::init(const std::string& path)
 {
-	// Read in the config values
-	std::ifstream fin(path);
-	std::string directive, fontPath;
-	int wWidth, wHeight, fullscreen, fontSize, red, green, blue = 0;
-	bool failedToFind = true;
-
-	while (fin >> directive)
+	// Read in the config values, the game can't run with anything missing or out of range
+	m_configPath = path;
+	Config config;
+	if (!config.load(path))
 	{
-		failedToFind = false;
-		std::cout << directive << std::endl;
-		if (directive == "Window")
+		for (const std::string& error : config.errors)
 		{
-			// Read window values
-			fin >> wWidth >> wHeight >> m_frameRateLimit >> fullscreen;
+			std::cerr << error << std::endl;
 		}
-		else if (directive == "Font")
+		exit(-1);
+	}
+	m_playerConfig = config.player;
+	m_enemyConfig = config.enemy;
+	m_bulletConfig = config.bullet;
+	m_specialCooldown = config.specialCooldown;
+	m_frameRateLimit = config.window.frameRateLimit;
+	m_tickRate = config.tickRate;
+	m_maxTicksPerFrame = config.maxTicksPerFrame;
+	m_poolSize = config.poolSize;
+	m_threads = config.threads;
+	if (config.headless)
+	{
+		// Run without a window for this many ticks, 0 runs until killed
+		m_options.headless = true;
+		m_options.ticks = config.headlessTicks;
+	}
+
+	// Everything random comes from m_rng, seeded from the replay, the options, or the OS
+	m_seed = m_options.seed;
+	if (!m_options.replay.empty())
+	{
+		if (!m_replay.open(m_options.replay))
 		{
-			// Read font values
-			fin >> fontPath >> fontSize >> red >> green >> blue;
-			// Setting up font
-			if (!m_font.loadFromFile(fontPath))
-			{
-				std::cerr << "Could not load the font" << std::endl;
-				exit(-1);
-			}
-			m_text = sf::Text("Score: " + m_score, m_font, fontSize);
-			m_text.setFillColor(sf::Color(red, green, blue));
-			m_text.setPosition(0 + m_text.getCharacterSize(), (0 + m_text.getCharacterSize()));
+			exit(-1);
 		}
-		else if (directive == "Player")
+		m_seed = m_replay.seed();
+		if (m_replay.tickRate() != (uint32_t)m_tickRate)
 		{
-			// Read player values
-			fin >> m_playerConfig.SR >> m_playerConfig.CR >> m_playerConfig.S >> m_playerConfig.FR >> m_playerConfig.FG >> m_playerConfig.FB >>
-				m_playerConfig.OR >> m_playerConfig.OG >> m_playerConfig.OB >> m_playerConfig.OT >> m_playerConfig.V;
+			std::cerr << "Input log was recorded at " << m_replay.tickRate() << " ticks/s, but the config runs at " << m_tickRate
+				<< ", the replay won't match" << std::endl;
 		}
-		else if (directive == "Enemy")
+	}
+	else if (m_seed == 0)
+	{
+		std::random_device device;
+		m_seed = ((uint64_t)device() << 32) | device();
+	}
+	m_rng.setSeed(m_seed);
+	std::cout << "Seed: " << m_seed << std::endl;
+
+	if (!m_options.record.empty())
+	{
+		m_recorder.open(m_options.record, m_seed, m_tickRate);
+	}
+
+	// The input log doesn't hold the load test's spawn rates, so the same seed and options reproduce a run instead
+	if (!m_options.load.target.empty())
+	{
+		if (!m_options.record.empty() || !m_options.replay.empty())
 		{
-			// Read enemy values
-			fin >> m_enemyConfig.SR >> m_enemyConfig.CR >> m_enemyConfig.SMIN >> m_enemyConfig.SMAX >> m_enemyConfig.OR >> m_enemyConfig.OG >> m_enemyConfig.OB >>
-				m_enemyConfig.OT >> m_enemyConfig.VMIN >> m_enemyConfig.VMAX >> m_enemyConfig.L >> m_enemyConfig.SI;
+			std::cerr << "A load test can't be recorded or replayed, run it again with the same seed and options" << std::endl;
+			exit(-1);
 		}
-		else if (directive == "Bullet")
+		if (!m_loadTest.start(m_options.load, m_seed, m_tickRate))
 		{
-			// Read bullet values
-			fin >> m_bulletConfig.SR >> m_bulletConfig.CR >> m_bulletConfig.S >> m_bulletConfig.FR >> m_bulletConfig.FG >> m_bulletConfig.FB >> m_bulletConfig.OR >>
-				m_bulletConfig.OG >> m_bulletConfig.OB >> m_bulletConfig.OT >> m_bulletConfig.V >> m_bulletConfig.L;
+			exit(-1);
 		}
-		else
+	}
+
+	// Changing the config mid game would break recordings, replays and load tests, so only watch it otherwise
+	if (m_options.record.empty() && m_options.replay.empty() && !m_loadTest.enabled() && m_configWatcher.open(path))
+	{
+		std::cout << "Watching " << path << " for changes" << std::endl;
+	}
+
+	// The arena is the window's size unless the config makes it bigger, even when there's no window
+	// to show it in. A bigger arena scrolls, the camera follows the player around it.
+	m_viewSize = Vec2((float)config.window.width, (float)config.window.height);
+	m_arenaSize = config.arena.width > 0 ? Vec2((float)config.arena.width, (float)config.arena.height) : m_viewSize;
+
+	// Without a window there's nothing to draw, so skip the font as well
+	if (!m_options.headless)
+	{
+		// Setting up font
+		if (!m_font.loadFromFile(config.font.path))
 		{
-			std::cerr << "Directive not recognized for: " << directive << std::endl;
+			std::cerr << "Could not load the font" << std::endl;
 			exit(-1);
 		}
+		m_text = sf::Text("Score: " + m_score, m_font, config.font.size);
+		m_text.setFillColor(sf::Color(config.font.r, config.font.g, config.font.b));
+		m_text.setPosition(0 + m_text.getCharacterSize(), (0 + m_text.getCharacterSize()));
+
+		// Create window
+		if (config.window.fullscreen == 1)
+		{
+			m_window.create(sf::VideoMode(config.window.width, config.window.height), "Shapebattlia", sf::Style::Fullscreen);
+
+		}
+		else {
+			m_window.create(sf::VideoMode(config.window.width, config.window.height), "Shapebattlia");
+		}
+		m_window.setFramerateLimit(m_frameRateLimit);
 	}
-	if (failedToFind)
+
+	// Broadphase cells are sized so a full size enemy spans at most a 2x2 block of them
+	m_enemyGrid.setCellSize(2.0f * m_enemyConfig.CR);
+
+	// Preallocate everything that scales with the entity count, so a steady game doesn't allocate
+	m_entities.reserve(m_poolSize);
+	m_entities.setStableOrder(config.stableOrder == 1);
+	m_enemyX.reserve(m_poolSize);
+	m_enemyY.reserve(m_poolSize);
+	m_enemyR.reserve(m_poolSize);
+	m_enemyGrid.reserve(m_poolSize);
+	m_candidates.reserve(m_poolSize);
+	m_candidateX.reserve(m_poolSize);
+	m_candidateY.reserve(m_poolSize);
+	m_candidateR.reserve(m_poolSize);
+	m_hits.reserve(m_poolSize);
+	m_enemyResolved.reserve(m_poolSize);
+	m_splitEnemies.reserve(m_poolSize);
+	m_shapeBatch.reserve(m_poolSize, (size_t)std::max(m_enemyConfig.VMAX, std::max(m_playerConfig.V, m_bulletConfig.V)));
+	m_liveFires.reserve(64);
+	m_tickFires.reserve(64);
+	m_timers.reserve(m_poolSize);
+	m_firedTimers.reserve(m_poolSize);
+
+	m_scheduler.setThreads(m_threads);
+
+
+	spawnPlayer();
+	resetTimers();
+
+	// Warm start from a saved world, which replaces everything spawned so far
+	if (!m_options.snapshot.empty() && !Snapshot::load(*this, m_options.snapshot))
 	{
-		std::cout << "Failed to find" << std::endl;
+		exit(-1);
 	}
+}
 
-	// Create window
-	if (fullscreen == 1)
+void Game::reloadConfig()
+{
+	Config config;
+	if (!config.load(m_configPath))
 	{
-		m_window.create(sf::VideoMode(wWidth, wHeight), "Shapebattlia", sf::Style::Fullscreen);
-
+		// Keep playing with what we had, the file is probably still being edited
+		std::cerr << "Not reloading " << m_configPath << ":" << std::endl;
+		for (const std::string& error : config.errors)
+		{
+			std::cerr << "  " << error << std::endl;
+		}
+		return;
 	}
-	else {
-		m_window.create(sf::VideoMode(wWidth, wHeight), "Shapebattlia");
+
+	// The arena stays as it started, so the new enemies still have to fit in it
+	if (2.0f * config.enemy.SR > m_arenaSize.x || 2.0f * config.enemy.SR > m_arenaSize.y)
+	{
+		std::cerr << "Not reloading " << m_configPath << ": Enemy SR (" << config.enemy.SR << ") doesn't fit in the " <<
+			m_arenaSize.x << "x" << m_arenaSize.y << " arena" << std::endl;
+		return;
 	}
-	m_window.setFramerateLimit(m_frameRateLimit);
 
+	// Only the gameplay settings change while running, the window, simulation rate and pools stay as they started.
+	// New values take effect for everything spawned from now on, and for the player straight away.
+	m_playerConfig = config.player;
+	m_enemyConfig = config.enemy;
+	m_bulletConfig = config.bullet;
+	m_specialCooldown = config.specialCooldown;
+	m_enemyGrid.setCellSize(2.0f * m_enemyConfig.CR);
 
-	spawnPlayer();
+	// A new spawn interval or cooldown counts from the last spawn or shot
+	scheduleEnemySpawn();
+	scheduleSpecialReady();
+
+	const size_t playerRow = m_entities.row(m_player);
+	m_entities.get<CShape>(playerRow).set(m_shapes.intern(m_playerConfig.V, m_playerConfig.SR, m_playerConfig.OT),
+		sf::Color(m_playerConfig.FR, m_playerConfig.FG, m_playerConfig.FB), sf::Color(m_playerConfig.OR, m_playerConfig.OG, m_playerConfig.OB));
+	m_entities.get<CCollision>(playerRow).radius = (float)m_playerConfig.CR;
+
+	std::cout << "Reloaded Player, Enemy, Bullet and SpecialCooldown from " << m_configPath << " on tick " << m_currentFrame << std::endl;
 }
 
 void Game::run()
 {
-	// some systems should function while paused (like rendering)
-	// while others should not (like movement/input)
+	if (m_options.headless)
+	{
+		runHeadless();
+	}
+	else
+	{
+		runWindowed();
+	}
+
+	m_recorder.finish(m_currentFrame);
+	if (!m_options.trace.empty())
+	{
+		m_profiler.exportTrace(m_options.trace);
+	}
+	m_loadTest.finish();
+	std::cout << "Finished on tick " << m_currentFrame << " with score " << m_score << ", state checksum " << std::hex << checksum() << std::dec << std::endl;
+
+	if (!m_options.saveSnapshot.empty())
+	{
+		Snapshot::save(*this, m_options.saveSnapshot);
+	}
+}
+
+void Game::runWindowed()
+{
+	// The simulation runs in fixed steps of 1/m_tickRate seconds, however long frames take to render.
+	// Real time piles up in the accumulator and is spent one tick at a time, and rendering
+	// interpolates between the last two ticks with whatever is left over.
+	const float tickLength = 1.0f / m_tickRate;
+	const float maxBacklog = tickLength * m_maxTicksPerFrame;
+	float accumulator = 0.0f;
+	sf::Clock clock;
+
 	while (m_running)
 	{
-		m_entities.update();
+		Profiler::Scope scope(m_profiler, "frame");
+		accumulator += clock.restart().asSeconds();
 
-		if (!m_paused)
+		// After a long stall, drop the time we can't catch up on rather than spiralling
+		if (accumulator > maxBacklog)
 		{
-			// Do the things that you can do if not paused!
-			sEnemySpawner();
-			sMovement();
-			sCollision();
-			sLifespan();
-
-			// Increment the current frame, only do when not paused
-			m_currentFrame++;
+			accumulator = maxBacklog;
 		}
 
 		// Always need to take in input and render, regardless of whether we're paused
+		pollEvents();
+
+		while (accumulator >= tickLength)
+		{
+			tick();
+			accumulator -= tickLength;
+		}
+
+		// Nothing moves while paused, so don't interpolate
+		sRender(m_paused ? 1.0f : accumulator / tickLength);
+	}
+}
+
+// Tick as fast as the CPU allows with no window, reporting progress once per simulated minute
+void Game::runHeadless()
+{
+	const long reportInterval = m_tickRate * 60;
+	sf::Clock clock;
+	long ticks = 0;
+
+	long lastReportTick = 0;
+	uint64_t lastReportAllocations = 0;
+
+	auto report = [&]()
+	{
+		float seconds = clock.getElapsedTime().asSeconds();
+		float simSeconds = (float)ticks / m_tickRate;
+		double allocationsPerTick = (double)(m_totalTickAllocations - lastReportAllocations) / (ticks - lastReportTick);
+		std::cout << "ticks: " << ticks << " entities: " << m_entities.size() << " score: " << m_score
+			<< " ticks/s: " << (seconds > 0 ? ticks / seconds : 0)
+			<< " speed: " << (seconds > 0 ? simSeconds / seconds : 0) << "x real time"
+			<< " allocations/tick: " << allocationsPerTick << std::endl;
+		lastReportTick = ticks;
+		lastReportAllocations = m_totalTickAllocations;
+	};
+
+	while (m_running && (m_options.ticks == 0 || ticks < m_options.ticks))
+	{
+		const int frame = m_currentFrame;
+		tick();
+
+		// A replay that ran out ends the game before simulating the tick, so it doesn't count
+		if (!m_running && m_currentFrame == frame)
+		{
+			break;
+		}
+		ticks++;
+
+		if (ticks % reportInterval == 0)
+		{
+			report();
+		}
+	}
+
+	if (ticks % reportInterval != 0)
+	{
+		report();
+	}
+
+	// Where the time went, per system
+	for (const Profiler::Stats& stats : m_profiler.stats())
+	{
+		std::printf("%-24s p50 %8.4f ms  p99 %8.4f ms\n", stats.name.c_str(), stats.p50, stats.p99);
+	}
+}
+
+void Game::tick()
+{
+	Profiler::Scope scope(m_profiler, "tick");
+	const uint64_t allocationsBefore = AllocationCounter::allocations();
+
+	// Config changes are picked up between ticks, so a tick never sees half old and half new values
+	if (m_configWatcher.changed())
+	{
+		reloadConfig();
+	}
+
+	// some systems should function while paused (like rendering)
+	// while others should not (like movement/input)
+	if (!m_paused)
+	{
 		sUserInput();
-		sRender();
 
+		// A replay can end the game here, don't simulate past the end of the recording
+		if (!m_running)
+		{
+			return;
+		}
+	}
+
+	{
+		Profiler::Scope updateScope(m_profiler, "EntityManager::update");
+		m_entities.update();
+		m_lastUpdateTick = m_currentFrame;
+
+		// The update moves enemies around their bucket, the grid is right again once sCollision rebuilds it
+		m_enemyGridCurrent = false;
+	}
+
+	if (!m_paused)
+	{
+		// Do the things that you can do if not paused! Each system runs on this thread, in order,
+		// which keeps the simulation deterministic. sMovement spreads its rows over the scheduler's threads.
+		sEnemySpawner();
+		sMovement();
+		sCollision();
+		sResolveCollisions();
+		sTimers();
+
+		// Increment the current tick, only do when not paused
+		m_currentFrame++;
+	}
+
+	// Heap allocations made by the simulation, this should stay at zero once the pools are warm
+	m_tickAllocations = AllocationCounter::allocations() - allocationsBefore;
+	m_totalTickAllocations += m_tickAllocations;
+
+	if (m_loadTest.enabled() && !m_paused && !m_loadTest.afterTick(*this))
+	{
+		m_running = false;
 	}
 }
 
@@ -119,23 +383,23 @@ void Game::setPaused(bool paused)
 void Game::spawnPlayer()
 {
 	// We create every entity by calling EntityManager.addEntity(tag)
-	// This returns an std::shared_ptr<Entity>, so we use 'auto' to save typing
-	auto entity = m_entities.addEntity("player");
+	// This returns an Entity handle, so we use 'auto' to save typing
+	auto entity = m_entities.addEntity(Tag::Player);
 
 	// Spawn the player at the center of the window
-	float mx = m_window.getSize().x / 2.0f;
-	float my = m_window.getSize().y / 2.0f;
-	entity->cTransform = std::make_shared<CTransform>(Vec2(mx, my), Vec2(0.0, 0.0), 0.0f);
+	float mx = m_arenaSize.x / 2.0f;
+	float my = m_arenaSize.y / 2.0f;
+	m_entities.addComponent(entity, CTransform(Vec2(mx, my), Vec2(0.0, 0.0), 0.0f));
 
 	// Its shape will have the attributes defined by the m_playerConfig
-	entity->cShape = std::make_shared<CShape>(m_playerConfig.SR, m_playerConfig.V, sf::Color(m_playerConfig.FR, m_playerConfig.FG, m_playerConfig.FB),
-		sf::Color(m_playerConfig.OR, m_playerConfig.OG, m_playerConfig.OB), m_playerConfig.OT);
+	m_entities.addComponent<CShape>(entity).set(m_shapes.intern(m_playerConfig.V, m_playerConfig.SR, m_playerConfig.OT),
+		sf::Color(m_playerConfig.FR, m_playerConfig.FG, m_playerConfig.FB), sf::Color(m_playerConfig.OR, m_playerConfig.OG, m_playerConfig.OB));
 
 	// Add Collision
-	entity->cCollision = std::make_shared<CCollision>(m_playerConfig.CR);
+	m_entities.addComponent(entity, CCollision(m_playerConfig.CR));
 
 	// Add an input component to the player so that we can use inputs
-	entity->cInput = std::make_shared<CInput>();
+	m_entities.addComponent(entity, CInput());
 
 	// Since we want this Entity to be our player, set our Game's player variable to this Entity
 	// This goes slightly against the EntityManager paradigm, but we use the player so much it's worth it
@@ -145,25 +409,25 @@ void Game::spawnPlayer()
 // Spawn an enemy at a random position
 void Game::spawnEnemy()
 {
-	auto entity = m_entities.addEntity("enemy");
+	auto entity = m_entities.addEntity(Tag::Enemy);
 
 	// Spawns at a random position on screen
 	// Min should be 0 + radius
-	// Max should be m_window.getSize().x/y - radius
+	// Max should be m_arenaSize.x/y - radius
 	int min, maxX, maxY;
 	min = 0 + m_enemyConfig.SR;
-	maxX = m_window.getSize().x - m_enemyConfig.SR;
-	maxY = m_window.getSize().y - m_enemyConfig.SR;
+	maxX = (int)m_arenaSize.x - m_enemyConfig.SR;
+	maxY = (int)m_arenaSize.y - m_enemyConfig.SR;
 	float ex = (float)randInRange(min, maxX);
 	float ey = (float)randInRange(min, maxY);
 	Vec2 originVec = Vec2(ex, ey);
 
 	// Determine starting vector, pointing towards player, with random speed from config
-	Vec2 targetVec = m_player->cTransform->pos - originVec;
+	Vec2 targetVec = m_entities.transforms().pos(m_entities.row(m_player)) - originVec;
 	targetVec.normalize();
 	int randSpeed = randInRange(m_enemyConfig.SMIN, m_enemyConfig.SMAX);
 	targetVec *= randSpeed;
-	entity->cTransform = std::make_shared<CTransform>(originVec, targetVec, 0.0f);
+	m_entities.addComponent(entity, CTransform(originVec, targetVec, 0.0f));
 
 	// Determine random number of vertices from min and max defined in config
 	int randVertices = randInRange(m_enemyConfig.VMIN, m_enemyConfig.VMAX);
@@ -175,13 +439,15 @@ void Game::spawnEnemy()
 	randB = randInRange(0, 255);
 
 	// Construct the entity's shape with random number of vertices, random color, and outline color set from config
-	entity->cShape = std::make_shared<CShape>(m_enemyConfig.SR, randVertices, sf::Color(randR, randG, randB),
-		sf::Color(m_enemyConfig.OR, m_enemyConfig.OG, m_enemyConfig.OB), m_enemyConfig.OT);
-	entity->cShape->circle.setOrigin(m_enemyConfig.SR, m_enemyConfig.SR);
-	entity->cCollision = std::make_shared<CCollision>(m_enemyConfig.CR);
+	m_entities.addComponent<CShape>(entity).set(m_shapes.intern(randVertices, m_enemyConfig.SR, m_enemyConfig.OT),
+		sf::Color(randR, randG, randB), sf::Color(m_enemyConfig.OR, m_enemyConfig.OG, m_enemyConfig.OB));
+
+	// Enemies bounce off the edges of the arena
+	m_entities.transforms().bounceRadius[m_entities.row(entity)] = (float)m_enemyConfig.SR;
+	m_entities.addComponent(entity, CCollision(m_enemyConfig.CR));
 
 	// Give it a score equal to 100 * its vertices
-	entity->cScore = std::make_shared<CScore>(100 * randVertices);
+	m_entities.addComponent(entity, CScore(100 * randVertices));
 
 	// record when the most recent enemy was spawned
 	m_lastEnemySpawnTime = m_currentFrame;
@@ -189,328 +455,618 @@ void Game::spawnEnemy()
 }
 
 // spawns the small enemies when a big one explodes
-void Game::spawnSmallEnemies(std::shared_ptr<Entity> e)
+void Game::spawnSmallEnemies(Entity e)
 {
 	// When we create the smaller enemy, we have to read the values of the original enemy
 	// - spawn a number of small enemies equal to the vertices of the original enemy
 	// - set each small enemy to the same color as the original, half the size
 	// - small enemies are worth double points of the original enemy
-	size_t verts = e->cShape->circle.getPointCount();
+	// Copy what we need out of the parent first, adding entities can reallocate the component arrays
+	const size_t parentRow = m_entities.row(e);
+	const CShape& parentShape = m_entities.get<CShape>(parentRow);
+	const ShapeGeometry& parentGeometry = m_shapes.get(parentShape.geometry);
+	const float radius = parentGeometry.radius / 2;
+	const sf::Color fill = parentShape.fill;
+	const sf::Color outline = parentShape.outline;
+	size_t verts = parentGeometry.points;
+	// Every fragment shares one geometry
+	const ShapeCache::Id geometry = m_shapes.intern(verts, radius, parentGeometry.outlineThickness);
+	const Vec2 parentPos = m_entities.transforms().pos(parentRow);
+	const int parentScore = m_entities.get<CScore>(parentRow).score;
 	float angleSteps = (2 * 3.1415926) / (float)verts;
 	// Speed is the parent's velocity's length
-	float speed = e->cTransform->velocity.length();
+	float speed = m_entities.transforms().velocity(parentRow).length();
 
 	// Spawn a small enemy for each vertice of the parent enemy
 	for (size_t i = 0; i < verts; i++)
 	{
-		auto smallEntity = m_entities.addEntity("enemy");
+		auto smallEntity = m_entities.addEntity(Tag::Enemy);
 		float angle = angleSteps * (float)i;
 		Vec2 smallVelocity = Vec2(cosf(angle), sinf(angle));
 		smallVelocity *= speed;
 		// Position is the same as the parent's, velocity is at an interval based on # of vertices
 		// angle is i * angleSteps;
 		// New velocity is Vec2(s * cosa, s*sina)
-		smallEntity->cTransform = std::make_shared<CTransform>(e->cTransform->pos, smallVelocity, 0.0f);
+		m_entities.addComponent(smallEntity, CTransform(parentPos, smallVelocity, 0.0f));
 
-		smallEntity->cShape = std::make_shared<CShape>(e->cShape->circle);
-		float radius = smallEntity->cShape->circle.getRadius() / 2;
-		smallEntity->cShape->circle.setRadius(radius);
-		smallEntity->cShape->circle.setOrigin(radius, radius);
-		smallEntity->cCollision = std::make_shared<CCollision>(m_enemyConfig.CR / 2);
-		smallEntity->cLifespan = std::make_shared<CLifespan>(m_enemyConfig.L);
-		smallEntity->cScore = std::make_shared<CScore>(e->cScore->score * 2);
+		m_entities.addComponent<CShape>(smallEntity).set(geometry, fill, outline);
+		m_entities.transforms().bounceRadius[m_entities.row(smallEntity)] = radius;
+		m_entities.addComponent(smallEntity, CCollision(m_enemyConfig.CR / 2));
+		addLifespan(smallEntity, m_enemyConfig.L);
+		m_entities.addComponent(smallEntity, CScore(parentScore * 2));
 
 	}
 
 
 }
 
-void Game::spawnBullet(std::shared_ptr<Entity> entity, const Vec2& target)
+void Game::spawnBullet(Entity entity, const Vec2& target)
 {
 	// - bullet speed is given as a scalar speed
 	// - you must set the velocity using formula in notes
 
-	auto bullet = m_entities.addEntity("bullet");
+	auto bullet = m_entities.addEntity(Tag::Bullet);
 	// cTransform(pos, vel, angle)
 	// dVector is target - entity.position
 	// We can normalize, and multiply by speed from here
 	// or..
 	// a is atan2f(dVec.y, dVec.x)
 	// final vector Vec2(speed * cos a, speed * sin a)
-	Vec2 originPosition = entity->cTransform->pos;
+	Vec2 originPosition = m_entities.transforms().pos(m_entities.row(entity));
 	Vec2 dVec = target - originPosition;
 	// Normalizing and multiplying by speed
 	dVec.normalize();
 	dVec *= m_bulletConfig.S;
-	bullet->cTransform = std::make_shared<CTransform>(originPosition, dVec, 0);
+	m_entities.addComponent(bullet, CTransform(originPosition, dVec, 0));
 
 	// Give the bullet attributes as according to m_bulletConfig
-	bullet->cShape = std::make_shared<CShape>(m_bulletConfig.SR, m_bulletConfig.V, sf::Color(m_bulletConfig.FR, m_bulletConfig.FG, m_bulletConfig.FB),
-		sf::Color(m_bulletConfig.OR, m_bulletConfig.OG, m_bulletConfig.OB), m_bulletConfig.OT);
-	bullet->cCollision = std::make_shared<CCollision>(m_bulletConfig.CR);
-	bullet->cLifespan = std::make_shared<CLifespan>(m_bulletConfig.L);
+	m_entities.addComponent<CShape>(bullet).set(m_shapes.intern(m_bulletConfig.V, m_bulletConfig.SR, m_bulletConfig.OT),
+		sf::Color(m_bulletConfig.FR, m_bulletConfig.FG, m_bulletConfig.FB), sf::Color(m_bulletConfig.OR, m_bulletConfig.OG, m_bulletConfig.OB));
+	m_entities.addComponent(bullet, CCollision(m_bulletConfig.CR));
+	addLifespan(bullet, m_bulletConfig.L);
 }
 
-void Game::spawnSpecialWeapon(std::shared_ptr<Entity> entity, const Vec2& target)
+void Game::spawnSpecialWeapon(Entity entity, const Vec2& target)
 {
-	auto bullet = m_entities.addEntity("specialWeapon");
+	auto bullet = m_entities.addEntity(Tag::SpecialWeapon);
 
 	// Determine the direction vector
-	Vec2 originPosition = entity->cTransform->pos;
+	Vec2 originPosition = m_entities.transforms().pos(m_entities.row(entity));
 	Vec2 dVec = target - originPosition;
 	dVec.normalize();
 
 	// Multiplying by speed, half that of a normal bullet
 	dVec *= (m_bulletConfig.S / 2);
-	bullet->cTransform = std::make_shared<CTransform>(originPosition, dVec, 0);
+	m_entities.addComponent(bullet, CTransform(originPosition, dVec, 0));
 
 	// Shares shape of a normal bullet, but is three times the size
-	bullet->cShape = std::make_shared<CShape>(m_bulletConfig.SR * 3, m_bulletConfig.V, sf::Color(m_bulletConfig.FR, m_bulletConfig.FG, m_bulletConfig.FB),
-		sf::Color(m_bulletConfig.OR, m_bulletConfig.OG, m_bulletConfig.OB), m_bulletConfig.OT);
-	bullet->cCollision = std::make_shared<CCollision>(m_bulletConfig.CR * 3);
+	m_entities.addComponent<CShape>(bullet).set(m_shapes.intern(m_bulletConfig.V, m_bulletConfig.SR * 3, m_bulletConfig.OT),
+		sf::Color(m_bulletConfig.FR, m_bulletConfig.FG, m_bulletConfig.FB), sf::Color(m_bulletConfig.OR, m_bulletConfig.OG, m_bulletConfig.OB));
+	m_entities.addComponent(bullet, CCollision(m_bulletConfig.CR * 3));
 
 	// Have it last three times as long
-	bullet->cLifespan = std::make_shared<CLifespan>(m_bulletConfig.L * 3);
+	addLifespan(bullet, m_bulletConfig.L * 3);
 }
 
 void Game::sMovement()
 {
-	for (auto e : m_entities.getEntities())
+	Profiler::Scope scope(m_profiler, "sMovement");
+
+	auto& tf = m_entities.transforms();
+	tf.storePrevious(m_entities.size());
+
+	// Handle the player based on its input
+	for (size_t i : m_entities.view<CTransform, CInput>())
 	{
-		// Skip if it doesn't have a transform component
-		if (e->cTransform == nullptr)
+		const CInput& input = m_entities.get<CInput>(i);
+		Vec2 velocity(0.0, 0.0);
+		// Speed is determined by the player config
+		if (input.up)
 		{
-			continue;
+			velocity.y -= m_playerConfig.S;
+		}
+		if (input.down)
+		{
+			velocity.y += m_playerConfig.S;
+		}
+		if (input.left)
+		{
+			velocity.x -= m_playerConfig.S;
+		}
+		if (input.right)
+		{
+			velocity.x += m_playerConfig.S;
 		}
 
-		// Handle based on input if it has input
-		if (!(e->cInput == nullptr))
+		// If we have a value for both x and y, calculate the 'correct' vector
+		if (!(velocity.x == 0 || velocity.y == 0))
 		{
-			e->cTransform->velocity = { 0.0, 0.0 };
-			// Speed is determined by the player config
-			if (e->cInput->up)
-			{
-				e->cTransform->velocity.y -= m_playerConfig.S;
-			}
-			if (e->cInput->down)
-			{
-				e->cTransform->velocity.y += m_playerConfig.S;
-			}
-			if (e->cInput->left)
-			{
-				e->cTransform->velocity.x -= m_playerConfig.S;
-			}
-			if (e->cInput->right)
-			{
-				e->cTransform->velocity.x += m_playerConfig.S;
-			}
+			// angle is arctan of y/x, speed is speed
+			float a = atan2f(velocity.y, velocity.x);
+			velocity = Vec2::fromAngleAndSpeed(a, m_playerConfig.S);
+		}
+		tf.setVelocity(i, velocity);
 
-			// If we have a value for both x and y, calculate the 'correct' vector
-			if (!(e->cTransform->velocity.x == 0 || e->cTransform->velocity.y == 0))
+		Vec2 outOfBounds = outOfBoundsVec(i);
+		if (outOfBounds != Vec2(0.0, 0.0))
+		{
+			// Detecting a corner
+			if (outOfBounds == velocity * -1)
 			{
-				// angle is arctan of y/x, speed is speed
-				float a = std::atan2f(e->cTransform->velocity.y, e->cTransform->velocity.x);
-				e->cTransform->velocity = Vec2::fromAngleAndSpeed(a, m_playerConfig.S);
-			}
+				tf.setVelocity(i, Vec2(0.0, 0.0));
 
-			Vec2 outOfBounds = outOfBoundsVec(e);
-			if (outOfBounds != Vec2(0.0, 0.0))
+			}
+			// Allow movement in the non-blocked direction.
+			else
 			{
-				// Detecting a corner
-				if (outOfBounds == e->cTransform->velocity * -1)
+				if (outOfBounds.x != velocity.x)
 				{
-					e->cTransform->velocity = { 0.0, 0.0 };
-
+					tf.velX[i] = 0.0f;
 				}
-				// Allow movement in the non-blocked direction.
-				else
-				{
-					if (outOfBounds.x != e->cTransform->velocity.x)
-					{
-						e->cTransform->velocity.x = 0.0f;
-					}
-
-					if (outOfBounds.y != e->cTransform->velocity.y)
-					{
-						e->cTransform->velocity.y = 0.0f;
-					}
-				}
-			}
 
-		}
-		// Otherwise, just update
-		else
-		{
-			// Handle bounds for enemies remove conditional if you want bullets to bounce too!
-			if (e->tag() == "enemy")
-			{
-				Vec2 outOfBounds = outOfBoundsVec(e);
-				if (outOfBounds != Vec2(0.0, 0.0))
+				if (outOfBounds.y != velocity.y)
 				{
-					e->cTransform->velocity = outOfBounds;
-
+					tf.velY[i] = 0.0f;
 				}
 			}
 		}
+	}
+
+	// Every live entity has a transform, so bounce the enemies off the edges and integrate
+	// everything in one pass over the packed arrays. Entities with a bounce radius are the
+	// ones that bounce, give bullets one too if you want them to bounce!
+	// Everything spins a degree per tick.
+	const MovementKernel::Lanes lanes = { tf.posX.data(), tf.posY.data(), tf.velX.data(), tf.velY.data(),
+		tf.angle.data(), tf.bounceRadius.data() };
+	m_scheduler.parallelFor(m_entities.size(), MIN_CHUNK_ROWS, [&](size_t begin, size_t end)
+	{
+		MovementKernel::run(lanes, begin, end, m_arenaSize.x, m_arenaSize.y, 1.0f);
+	});
+}
+
+// Gives an entity a lifespan, and sets the timer that destroys it when it's up. The lifespan
+// counts from the entity's first tick in the world. New entities join at the next update,
+// so anything the systems spawn after this tick's update starts on the next tick.
+void Game::addLifespan(Entity entity, int ticks)
+{
+	const int start = m_lastUpdateTick == m_currentFrame ? m_currentFrame + 1 : m_currentFrame;
+	const CLifespan& lifespan = m_entities.addComponent(entity, CLifespan(ticks, start));
+	m_timers.schedule(lifespan.expires, Timer::Lifespan, entity);
+}
 
-		e->cTransform->pos += e->cTransform->velocity;
+// Enemies spawn once more than the spawn interval has gone by since the last one.
+// Load tests shorten the interval, they call this again when they change it.
+void Game::scheduleEnemySpawn()
+{
+	const float interval = m_enemyConfig.SI / m_loadTest.spawnMultiplier();
+	m_nextEnemySpawn = m_lastEnemySpawnTime + (int)interval + 1;
+	m_enemySpawnDue = m_nextEnemySpawn <= m_currentFrame;
+	if (!m_enemySpawnDue)
+	{
+		m_timers.schedule(m_nextEnemySpawn, Timer::EnemySpawn);
 	}
 }
 
-void Game::sLifespan()
+// The special weapon can fire again once more than its cooldown has gone by since the last shot
+void Game::scheduleSpecialReady()
 {
-	// Handle lifespan logic for all entities with a lifespan component
-	for (auto e : m_entities.getEntities())
+	m_specialReadyTick = m_lastSpecialShot + m_specialCooldown + 1;
+	m_specialReady = m_specialReadyTick <= m_currentFrame;
+	if (!m_specialReady)
 	{
-		//  if entity has no lifespan component, skip it
-		if (e->cLifespan == nullptr)
-		{
-			continue;
-		}
-		//	if entity has > 0 remaining lifespan, subtract 1
-		if (e->cLifespan->remaining > 0)
-		{
-			e->cLifespan->remaining -= 1;
-			
-			if (e->cShape != nullptr)
-			{
-				//  if it has lifespan and is alive
-				//		scale its alpha channel properly
-				auto currentFillColor = e->cShape->circle.getFillColor();
-				auto currentOtColor = e->cShape->circle.getOutlineColor();
-				float lifespanRatio = (float)e->cLifespan->remaining / (float)e->cLifespan->total;
-				currentFillColor.a = 255 * lifespanRatio;
-				currentOtColor.a = 255 * lifespanRatio;
-
-				// Special weapon grows and changes all of its colors!
-				if (e->tag() == "specialWeapon")
-				{
-					// Limit flashing to about four times a second - best practices for flashing patterns
-					if (m_currentFrame % (m_frameRateLimit / 4) == 0)
-					{
-						currentFillColor.r = randInRange(50, 255);
-						currentFillColor.g = randInRange(50, 255);
-						currentFillColor.b = randInRange(50, 255);
-						currentOtColor.r = currentFillColor.r;
-						currentOtColor.g = currentFillColor.g;
-						currentOtColor.b = currentFillColor.b;
-
-					}
-
-					// Grow bigger!
-					// What I want, is to target getting 3x bigger than the original size
-					// And linearly achieve that scale based on the lifespan ratio 1 + (2 * (1 - lifespanRatio))
-					float linearTripleGrowth = (1 + (2 * (1 - lifespanRatio)));
-					e->cShape->circle.setScale(linearTripleGrowth, linearTripleGrowth);
-					e->cCollision->radius = e->cShape->circle.getRadius() * linearTripleGrowth;
-				}
+		m_timers.schedule(m_specialReadyTick, Timer::SpecialReady);
+	}
+}
 
-				e->cShape->circle.setFillColor(currentFillColor);
-				e->cShape->circle.setOutlineColor(currentOtColor);
+// Sets every timer again from the current tick, the lifespans and when the game last spawned
+// and shot, for a new game or one just loaded from a snapshot
+void Game::resetTimers()
+{
+	m_timers.reset(m_currentFrame);
+	for (size_t i : m_entities.view<CLifespan>())
+	{
+		m_timers.schedule(m_entities.get<CLifespan>(i).expires, Timer::Lifespan, m_entities.getEntities()[i]);
+	}
+	scheduleEnemySpawn();
+	scheduleSpecialReady();
+}
 
+void Game::sTimers()
+{
+	Profiler::Scope scope(m_profiler, "sTimers");
+
+	// Move the wheel on to the next tick. Only the timers due then are touched, so lifespans cost
+	// as much as the entities dying this tick, however many are still alive. Going off at the end
+	// of the tick before means an entity lives through its last tick, and the spawner and the
+	// special weapon see their flags at the start of theirs.
+	m_firedTimers.clear();
+	m_timers.advance(m_currentFrame + 1, m_firedTimers);
+	for (const Timer& timer : m_firedTimers)
+	{
+		switch (timer.kind)
+		{
+		case Timer::Lifespan:
+			// Entities that were killed leave their timers behind, and the handle catches a slot that's been reused
+			if (m_entities.isActive(timer.entity) && m_entities.get<CLifespan>(timer.entity).expires == timer.due)
+			{
+				m_entities.destroy(timer.entity);
 			}
+			break;
+		case Timer::EnemySpawn:
+			m_enemySpawnDue |= timer.due == m_nextEnemySpawn;
+			break;
+		case Timer::SpecialReady:
+			m_specialReady |= timer.due == m_specialReadyTick;
+			break;
 		}
-		//	if it has lifespan and time is up destroy the entity
-		if (e->cLifespan->remaining <= 0)
+	}
+
+	// Special weapons also change all of their colors! This uses m_rng, so it stays on this thread,
+	// and the bucket's order is the same every run, so are the numbers drawn for each.
+	// Limit flashing to about four times a second - best practices for flashing patterns
+	if (m_currentFrame % (m_tickRate / 4) == 0)
+	{
+		for (uint32_t row : m_entities.rows(Tag::SpecialWeapon))
 		{
-			e->destroy();
+			CShape& shape = m_entities.get<CShape>(row);
+			shape.fill.r = randInRange(50, 255);
+			shape.fill.g = randInRange(50, 255);
+			shape.fill.b = randInRange(50, 255);
+			shape.outline.r = shape.fill.r;
+			shape.outline.g = shape.fill.g;
+			shape.outline.b = shape.fill.b;
 		}
 	}
 }
 
 void Game::sCollision()
 {
-	// Handle collision logic for different entity types
-	// Start with enemies since all collisions are currently based on that, minimize retracing steps
-	for (auto e : m_entities.getEntities("enemy"))
+	Profiler::Scope scope(m_profiler, "sCollision");
+
+	auto& tf = m_entities.transforms();
+	const size_t playerRow = m_entities.row(m_player);
+	const RowVec& enemies = m_entities.rows(Tag::Enemy);
+
+	// Broadphase: bucket every enemy into the spatial hash, so the player and each projectile
+	// are only tested against the enemies in the cells around them
+	const size_t enemyCount = enemies.size();
+	m_enemyX.resize(enemyCount);
+	m_enemyY.resize(enemyCount);
+	m_enemyR.resize(enemyCount);
+	for (size_t i = 0; i < enemyCount; i++)
+	{
+		const size_t er = enemies[i];
+		m_enemyX[i] = tf.posX[er];
+		m_enemyY[i] = tf.posY[er];
+		m_enemyR[i] = m_entities.get<CCollision>(er).radius;
+	}
+	m_enemyGrid.rebuild(m_enemyX.data(), m_enemyY.data(), m_enemyR.data(), enemyCount);
+	m_enemyGridCurrent = true;
+
+	// Narrowphase: pack the enemies in the cells around a circle and test them in batches,
+	// calling onHit(enemy index) for each overlap in the order the grid found them.
+	// onHit returns false to stop looking.
+	auto forEachHit = [&](float x, float y, float r, auto&& onHit)
 	{
-		if (m_player->cTransform->pos.dist(e->cTransform->pos) < e->cCollision->radius + m_player->cCollision->radius)
+		m_candidates.clear();
+		m_candidateX.clear();
+		m_candidateY.clear();
+		m_candidateR.clear();
+		m_enemyGrid.query(x, y, r, [&](uint32_t i)
 		{
-			// When player is hit, return to center and reduce score by score of the shape that hit you
-			m_player->cTransform->pos = Vec2(m_window.getSize().x / 2, m_window.getSize().y / 2);
-			if (m_score > 0)
-			{
-				int diff = m_score - e->cScore->score;
-				m_score = (diff > 0) ? diff : 0;
-			}
+			m_candidates.push_back(i);
+			m_candidateX.push_back(m_enemyX[i]);
+			m_candidateY.push_back(m_enemyY[i]);
+			m_candidateR.push_back(m_enemyR[i]);
+		});
 
-			if(e->cLifespan == nullptr)
+		for (size_t base = 0; base < m_candidates.size(); base += Narrowphase::BATCH)
+		{
+			size_t count = std::min(Narrowphase::BATCH, m_candidates.size() - base);
+			uint64_t hits = Narrowphase::overlaps(x, y, r, &m_candidateX[base], &m_candidateY[base], &m_candidateR[base], count);
+			for (size_t i = 0; hits != 0; i++, hits >>= 1)
 			{
-				spawnSmallEnemies(e);
+				if ((hits & 1) && !onHit(m_candidates[base + i]))
+				{
+					return;
+				}
 			}
-			e->destroy();
 		}
+	};
+
+	// Only record what hit what here, sResolveCollisions applies it all afterwards.
+	// Nothing in the world changes until then, so the tests don't depend on each other.
+	m_hits.clear();
+
+	// Handle collision logic for different entity types, all collisions are currently against enemies
+	forEachHit(tf.posX[playerRow], tf.posY[playerRow], m_entities.get<CCollision>(playerRow).radius, [&](uint32_t i)
+	{
+		// The player is sent back to the centre by this hit, so nothing else can be touching it
+		m_hits.push_back({ HitEvent::Player, m_player, i });
+		return false;
+	});
+
+	// Projectiles go by row, the handle is only looked up for the few that hit something
+	const RowVec& bullets = m_entities.rows(Tag::Bullet);
+	for (size_t b = 0; b < bullets.size(); b++)
+	{
+		const size_t br = bullets[b];
+		forEachHit(tf.posX[br], tf.posY[br], m_entities.get<CCollision>(br).radius, [&](uint32_t i)
+		{
+			m_hits.push_back({ HitEvent::Bullet, m_entities.getEntities(Tag::Bullet)[b], i });
+			return true;
+		});
+	}
 
-		// When a bullet hits an enemy, destroy both and increment the score by the enemy's worth
-		for (auto b : m_entities.getEntities("bullet"))
+	const RowVec& specials = m_entities.rows(Tag::SpecialWeapon);
+	for (size_t s = 0; s < specials.size(); s++)
+	{
+		const size_t sr = specials[s];
+		// Special weapons grow over their lifespan, and hit everything within their grown size
+		const float radius = m_entities.get<CCollision>(sr).radius * m_entities.get<CLifespan>(sr).growth(m_currentFrame);
+		forEachHit(tf.posX[sr], tf.posY[sr], radius, [&](uint32_t i)
 		{
-			if (b->cTransform->pos.dist(e->cTransform->pos) < b->cCollision->radius + e->cCollision->radius)
-			{
-				b->destroy();
-				m_score += e->cScore->score;
+			m_hits.push_back({ HitEvent::Special, m_entities.getEntities(Tag::SpecialWeapon)[s], i });
+			return true;
+		});
+	}
+}
 
-				// If it was a permanent enemy, spawnSmallEnemies
-				if(e->cLifespan == nullptr)
-				{
-					spawnSmallEnemies(e);
-				}
-				e->destroy();
-			}
+void Game::sResolveCollisions()
+{
+	Profiler::Scope scope(m_profiler, "sResolveCollisions");
+
+	auto& tf = m_entities.transforms();
+	const EntityVec& enemies = m_entities.getEntities(Tag::Enemy);
+	m_enemyResolved.assign(enemies.size(), 0);
+	m_splitEnemies.clear();
 
+	// Apply the hits in the order they were found. Every hit still affects its source,
+	// but each enemy only scores, splits and dies once however many things hit it.
+	for (const HitEvent& hit : m_hits)
+	{
+		if (hit.kind == HitEvent::Player)
+		{
+			// When player is hit, return to center and reduce score by score of the shape that hit you
+			tf.teleport(m_entities.row(m_player), m_arenaSize / 2);
 		}
+		else if (hit.kind == HitEvent::Bullet)
+		{
+			// When a bullet hits an enemy, destroy both and increment the score by the enemy's worth
+			m_entities.destroy(hit.source);
+		}
+		// When the special hits an enemy, destroy the enemy, but leave the special projectile in motion
 
-		// When the special hits an enemy, destroy the enemy, but leave the special projectile in motion. Increment score.
-		for (auto s : m_entities.getEntities("specialWeapon"))
+		if (m_enemyResolved[hit.enemy])
 		{
-			if (s->cTransform->pos.dist(e->cTransform->pos) < s->cCollision->radius + e->cCollision->radius)
-			{
-				m_score += e->cScore->score;
+			continue;
+		}
+		m_enemyResolved[hit.enemy] = 1;
 
-				if(e->cLifespan == nullptr)
-				{
-					spawnSmallEnemies(e);
-				}
-				e->destroy();
+		Entity e = enemies[hit.enemy];
+		const size_t er = m_entities.rows(Tag::Enemy)[hit.enemy];
+		const int enemyScore = m_entities.get<CScore>(er).score;
+		if (hit.kind == HitEvent::Player)
+		{
+			if (m_score > 0)
+			{
+				int diff = m_score - enemyScore;
+				m_score = (diff > 0) ? diff : 0;
 			}
+		}
+		else
+		{
+			m_score += enemyScore;
+		}
 
+		// If it was a permanent enemy, it splits into small ones
+		if (!m_entities.has<CLifespan>(er))
+		{
+			m_splitEnemies.push_back(e);
 		}
+		m_entities.destroy(e);
+	}
+
+	// Spawning can grow the component arrays, so it all happens once nothing else needs them.
+	// Destroyed enemies keep their rows until the next update, so their shapes can still be read.
+	for (Entity e : m_splitEnemies)
+	{
+		spawnSmallEnemies(e);
 	}
 }
 
 void Game::sEnemySpawner()
 {
-	if (m_currentFrame - m_lastEnemySpawnTime > m_enemyConfig.SI)
+	Profiler::Scope scope(m_profiler, "sEnemySpawner");
+
+	// The EnemySpawn timer says when. Load tests shorten the interval, and once it's under
+	// a tick spawn several enemies every tick.
+	if (!m_enemySpawnDue)
+	{
+		return;
+	}
+	const float interval = m_enemyConfig.SI / m_loadTest.spawnMultiplier();
+	const int count = std::max(1, (int)(1.0f / interval));
+	for (int i = 0; i < count; i++)
 	{
 		spawnEnemy();
 	}
-	
+	scheduleEnemySpawn();
 }
 
-void Game::sRender()
+// Centres the camera on the player, stopping at the edges of the arena so nothing past them is shown
+void Game::updateCamera(float alpha)
 {
-	m_window.clear();
+	auto& tf = m_entities.transforms();
+	const size_t row = m_entities.row(m_player);
+	const float x = tf.prevX[row] + (tf.posX[row] - tf.prevX[row]) * alpha;
+	const float y = tf.prevY[row] + (tf.posY[row] - tf.prevY[row]) * alpha;
+	const sf::Vector2f size(m_viewSize.x * m_zoom, m_viewSize.y * m_zoom);
+
+	// An arena smaller than the view just sits in the middle of it
+	auto follow = [](float player, float view, float arena)
+	{
+		return view >= arena ? arena / 2 : std::min(std::max(player, view / 2), arena - view / 2);
+	};
+	m_camera.setSize(size);
+	m_camera.setCenter(follow(x, size.x, m_arenaSize.x), follow(y, size.y, m_arenaSize.y));
+}
 
+// Zooms out by factor, or in when it's under 1, from half size up to the whole arena in view
+void Game::zoomCamera(float factor)
+{
+	const float whole = std::max(1.0f, std::max(m_arenaSize.x / m_viewSize.x, m_arenaSize.y / m_viewSize.y));
+	m_zoom = std::min(std::max(m_zoom * factor, 0.5f), whole);
+}
+
+// Fills m_shapeBatch with the shapes the camera can see, this is all the CPU side work of rendering.
+// Nothing is worked out for entities out of view, so the cost follows what's on screen rather than the
+// size of the arena. Shapes only a few pixels across, like fragments with the camera zoomed out, are
+// drawn as a plain square instead of their polygon and outline.
+void Game::buildShapeBatch(float alpha)
+{
+	// A radius under this many pixels doesn't show its corners
+	const float LOD_PIXELS = 3.0f;
+
+	auto& tf = m_entities.transforms();
+	m_shapeBatch.clear();
+	m_drawnShapes = 0;
 
-	// Eventually will look something like
-	for (auto e : m_entities.getEntities())
+	const sf::Vector2f& center = m_camera.getCenter();
+	const sf::Vector2f& size = m_camera.getSize();
+	const float left = center.x - size.x / 2, right = center.x + size.x / 2;
+	const float top = center.y - size.y / 2, bottom = center.y + size.y / 2;
+	const float pixelsPerUnit = m_viewSize.x / size.x;
+
+	auto draw = [&](size_t i)
 	{
-		e->cShape->circle.setPosition(e->cTransform->pos.x, e->cTransform->pos.y);
+		const CShape& shape = m_entities.get<CShape>(i);
+		const ShapeGeometry& geometry = m_shapes.get(shape.geometry);
+		const CLifespan* lifespan = m_entities.has<CLifespan>(i) ? &m_entities.get<CLifespan>(i) : nullptr;
+
+		// Special weapons grow over their lifespan
+		float scale = shape.scale;
+		if (lifespan && m_entities.tag(i) == Tag::SpecialWeapon)
+		{
+			scale *= lifespan->growth(m_currentFrame);
+		}
+
+		const float x = tf.prevX[i] + (tf.posX[i] - tf.prevX[i]) * alpha;
+		const float y = tf.prevY[i] + (tf.posY[i] - tf.prevY[i]) * alpha;
+		const float extent = geometry.extent * scale;
+		if (x + extent < left || x - extent > right || y + extent < top || y - extent > bottom)
+		{
+			return;
+		}
+		m_drawnShapes++;
+
+		// Anything with a lifespan fades out
+		sf::Color fill = shape.fill;
+		sf::Color outline = shape.outline;
+		if (lifespan)
+		{
+			fill.a = outline.a = lifespan->alpha(m_currentFrame);
+		}
 
-		// set the rotation of the shape based on the entity's transform->angle
-		e->cTransform->angle += 1.0f;
-		e->cShape->circle.setRotation(e->cTransform->angle);
+		if (geometry.radius * scale * pixelsPerUnit < LOD_PIXELS)
+		{
+			m_shapeBatch.addQuad(x, y, geometry.radius * scale, fill);
+			return;
+		}
+		m_shapeBatch.add(x, y, tf.angle[i], scale, geometry, fill, outline);
+	};
+
+	// Enemies are nearly everything, so they come from the broadphase grid's cells around the view when
+	// that's fewer than there are enemies. The grid has them where they were at the end of the tick, and
+	// they've moved at most SMAX since the one before, so the margin covers everything that could show.
+	const RowVec& enemies = m_entities.rows(Tag::Enemy);
+	const float margin = m_shapes.maxExtent() + m_enemyConfig.SMAX;
+	if (m_enemyGridCurrent && m_enemyGrid.cellCount(left - margin, top - margin, right + margin, bottom + margin) < enemies.size())
+	{
+		m_enemyGrid.queryRect(left - margin, top - margin, right + margin, bottom + margin, [&](uint32_t e)
+		{
+			draw(enemies[e]);
+		});
+	}
+	else
+	{
+		for (uint32_t row : enemies)
+		{
+			draw(row);
+		}
+	}
 
-		// draw the entity's sf::CircleShape
-		m_window.draw(e->cShape->circle);
+	// Then everything else on top
+	for (Tag tag : { Tag::Bullet, Tag::SpecialWeapon, Tag::Player })
+	{
+		for (uint32_t row : m_entities.rows(tag))
+		{
+			draw(row);
+		}
 	}
+}
+
+// alpha is how far we are between the previous tick and the current one
+void Game::sRender(float alpha)
+{
+	Profiler::Scope scope(m_profiler, "sRender");
 
-	m_text.setString("Score: " + std::to_string(m_score));
+	m_window.clear();
+
+	// Every shape goes into one batch, so the scene is a single draw call
+	updateCamera(alpha);
+	buildShapeBatch(alpha);
+	m_window.setView(m_camera);
+	m_window.draw(m_shapeBatch);
+
+	// The score and overlay stay put on screen
+	m_window.setView(m_window.getDefaultView());
+
+	// Only rebuild the score text when it changes, setString allocates
+	if (m_score != m_displayedScore)
+	{
+		m_displayedScore = m_score;
+		m_text.setString("Score: " + std::to_string(m_score));
+	}
 	m_window.draw(m_text);
+
+	if (m_showProfiler)
+	{
+		drawProfiler();
+	}
+
 	m_window.display();
 }
 
-void Game::sUserInput()
+// Lists each system's p50 and p99 over the last few seconds, under the score
+void Game::drawProfiler()
+{
+	std::string overlay = "system            p50 ms  p99 ms\n";
+	char line[96];
+	for (const Profiler::Stats& stats : m_profiler.stats())
+	{
+		std::snprintf(line, sizeof(line), "%-16.16s %7.3f %7.3f\n", stats.name.c_str(), stats.p50, stats.p99);
+		overlay += line;
+	}
+	overlay += "entities: " + std::to_string(m_entities.size()) + ", drawn: " + std::to_string(m_drawnShapes) + "\n";
+	overlay += "allocations last tick: " + std::to_string(m_tickAllocations);
+
+	sf::Vector2f scorePosition = m_text.getPosition();
+	unsigned scoreSize = m_text.getCharacterSize();
+	m_text.setCharacterSize(scoreSize / 2);
+	m_text.setPosition(scorePosition.x, scorePosition.y + scoreSize * 2);
+	m_text.setString(overlay);
+	m_window.draw(m_text);
+	m_text.setCharacterSize(scoreSize);
+	m_text.setPosition(scorePosition);
+}
+
+// Collects window events every frame. Key state and clicks are only stored here,
+// sUserInput applies them to the player on the next tick.
+void Game::pollEvents()
 {
+	Profiler::Scope scope(m_profiler, "pollEvents");
+
 	sf::Event event;
 	while (m_window.pollEvent(event))
 	{
@@ -526,16 +1082,16 @@ void Game::sUserInput()
 			switch (event.key.code)
 			{
 			case sf::Keyboard::W:
-				m_player->cInput->up = true;
+				m_liveInput.up = true;
 				break;
 			case sf::Keyboard::A:
-				m_player->cInput->left = true;
+				m_liveInput.left = true;
 				break;
 			case sf::Keyboard::S:
-				m_player->cInput->down = true;
+				m_liveInput.down = true;
 				break;
 			case sf::Keyboard::D:
-				m_player->cInput->right = true;
+				m_liveInput.right = true;
 				break;
 			case sf::Keyboard::X:
 				setPaused(!m_paused);
@@ -543,6 +1099,30 @@ void Game::sUserInput()
 			case sf::Keyboard::Escape:
 				m_running = false;
 				break;
+			case sf::Keyboard::F3:
+				m_showProfiler = !m_showProfiler;
+				break;
+			case sf::Keyboard::F4:
+				m_profiler.exportTrace(m_options.trace.empty() ? "trace.json" : m_options.trace);
+				break;
+			case sf::Keyboard::F5:
+				// A replay's input is in the log, not at the keyboard
+				if (m_replay.isOpen())
+				{
+					std::cerr << "Can't quicksave during a replay" << std::endl;
+					break;
+				}
+				Snapshot::save(*this, "quicksave.sbsn");
+				break;
+			case sf::Keyboard::F9:
+				// Loading swaps the world out from under the input log, which then wouldn't replay
+				if (m_recorder.isOpen() || m_replay.isOpen())
+				{
+					std::cerr << "Can't quickload while recording or replaying" << std::endl;
+					break;
+				}
+				Snapshot::load(*this, "quicksave.sbsn");
+				break;
 			default:
 				break;
 			}
@@ -554,16 +1134,16 @@ void Game::sUserInput()
 			switch (event.key.code)
 			{
 			case sf::Keyboard::W:
-				m_player->cInput->up = false;
+				m_liveInput.up = false;
 				break;
 			case sf::Keyboard::A:
-				m_player->cInput->left = false;
+				m_liveInput.left = false;
 				break;
 			case sf::Keyboard::S:
-				m_player->cInput->down = false;
+				m_liveInput.down = false;
 				break;
 			case sf::Keyboard::D:
-				m_player->cInput->right = false;
+				m_liveInput.right = false;
 				break;
 			default:
 				break;
@@ -573,41 +1153,115 @@ void Game::sUserInput()
 		// Need to add the pause check here as well or a player can shoot while things are paused!
 		if (event.type == sf::Event::MouseButtonPressed && !m_paused)
 		{
-			if (event.mouseButton.button == sf::Mouse::Left)
-			{
-				spawnBullet(m_player, Vec2(event.mouseButton.x, event.mouseButton.y));
-			}
+			// Shots are aimed at where the click is in the arena, not on the screen
+			sf::Vector2f target = m_window.mapPixelToCoords(sf::Vector2i(event.mouseButton.x, event.mouseButton.y), m_camera);
+			FireEvent fire;
+			fire.button = (uint8_t)event.mouseButton.button;
+			fire.x = target.x;
+			fire.y = target.y;
+			m_liveFires.push_back(fire);
+		}
+
+		// Scrolling down zooms out, to see more of a big arena
+		if (event.type == sf::Event::MouseWheelScrolled)
+		{
+			zoomCamera(event.mouseWheelScroll.delta < 0 ? 1.25f : 0.8f);
+		}
+	}
+}
+
+// Applies one tick's worth of input to the player, from the window or from a replay
+void Game::sUserInput()
+{
+	Profiler::Scope scope(m_profiler, "sUserInput");
+
+	CInput input = m_liveInput;
+	m_tickFires.swap(m_liveFires);
+	m_liveFires.clear();
+
+	// In a load test the bot plays instead of whoever is at the keyboard
+	if (m_loadTest.enabled())
+	{
+		m_tickFires.clear();
+		m_loadTest.bot().act(m_entities, m_player, m_arenaSize, m_tickRate, input, m_tickFires);
+	}
+
+	if (m_replay.isOpen() && !m_replay.read(m_currentFrame, input, m_tickFires))
+	{
+		// The recording is over, so is the game
+		m_running = false;
+		return;
+	}
+
+	m_recorder.record(m_currentFrame, input, m_tickFires);
+	m_entities.get<CInput>(m_player) = input;
 
-			if (event.mouseButton.button == sf::Mouse::Right)
+	for (const FireEvent& fire : m_tickFires)
+	{
+		if (fire.button == sf::Mouse::Left)
+		{
+			spawnBullet(m_player, Vec2(fire.x, fire.y));
+		}
+
+		if (fire.button == sf::Mouse::Right)
+		{
+			// If the recharge since the last fire has passed, you can start charging
+			// Recharges for SpecialCooldown ticks after each shot
+			if (m_specialReady)
 			{
-				// If the recharge since the last fire has passed, you can start charging
-				// For now, hardcode a cooldown of 180 frames
-				if (m_currentFrame > m_lastSpecialShot + 180)
-				{
-					spawnSpecialWeapon(m_player, Vec2(event.mouseButton.x, event.mouseButton.y));
-					m_lastSpecialShot = m_currentFrame;
-				}
+				spawnSpecialWeapon(m_player, Vec2(fire.x, fire.y));
+				m_lastSpecialShot = m_currentFrame;
+				scheduleSpecialReady();
 			}
 		}
 	}
+	m_tickFires.clear();
+}
+
+// FNV-1a hash of the score, tick and every live transform, two runs that replayed
+// identically finish with the same checksum
+uint64_t Game::checksum()
+{
+	uint64_t hash = 14695981039346656037ULL;
+	auto mix = [&hash](const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ bytes[i]) * 1099511628211ULL;
+		}
+	};
+
+	auto& tf = m_entities.transforms();
+	const size_t count = m_entities.size();
+	mix(&m_score, sizeof(m_score));
+	mix(&m_currentFrame, sizeof(m_currentFrame));
+	mix(tf.posX.data(), count * sizeof(float));
+	mix(tf.posY.data(), count * sizeof(float));
+	mix(tf.velX.data(), count * sizeof(float));
+	mix(tf.velY.data(), count * sizeof(float));
+	return hash;
 }
 
-bool Game::goingOutOfBounds(std::shared_ptr<Entity> entity)
+
+
+bool Game::goingOutOfBounds(size_t row)
 {
-	if (entity->cTransform == nullptr)
+	if (!m_entities.has<CTransform>(row))
 	{
 		return false;
 	}
 
-	Vec2 translatedVec = entity->cTransform->pos + entity->cTransform->velocity;
-	float radius = entity->cShape->circle.getRadius();
+	auto& tf = m_entities.transforms();
+	Vec2 translatedVec = tf.pos(row) + tf.velocity(row);
+	float radius = m_shapes.get(m_entities.get<CShape>(row).geometry).radius;
 	// Check top
 	if (translatedVec.y - radius < 0)
 	{
 		return true;
 	}
 	// Check bottom
-	if (translatedVec.y + radius > m_window.getSize().y)
+	if (translatedVec.y + radius > m_arenaSize.y)
 	{
 		return true;
 	}
@@ -617,7 +1271,7 @@ bool Game::goingOutOfBounds(std::shared_ptr<Entity> entity)
 		return true;
 	}
 	// Check right
-	if (translatedVec.x + radius > m_window.getSize().x)
+	if (translatedVec.x + radius > m_arenaSize.x)
 	{
 		return true;
 	}
@@ -627,23 +1281,24 @@ bool Game::goingOutOfBounds(std::shared_ptr<Entity> entity)
 
 // Return the "bounce vector" if an entity is moving out of bounds.
 // Return Vec2(0.0) when an entity can't be processed, or is not out of bounds.
-Vec2 Game::outOfBoundsVec(std::shared_ptr<Entity> entity)
+Vec2 Game::outOfBoundsVec(size_t row)
 {
-	Vec2 outOfBoundsVec = entity->cTransform->velocity;
-	if (entity->cTransform == nullptr)
+	if (!m_entities.has<CTransform>(row))
 	{
 		return Vec2(0.0, 0.0);
 	}
 
-	Vec2 translatedVec = entity->cTransform->pos + entity->cTransform->velocity;
-	float radius = entity->cShape->circle.getRadius();
+	auto& tf = m_entities.transforms();
+	Vec2 outOfBoundsVec = tf.velocity(row);
+	Vec2 translatedVec = tf.pos(row) + tf.velocity(row);
+	float radius = m_shapes.get(m_entities.get<CShape>(row).geometry).radius;
 	// Check top
 	if (translatedVec.y - radius < 0)
 	{
 		outOfBoundsVec.y *= -1;
 	}
 	// Check bottom
-	if (translatedVec.y + radius > m_window.getSize().y)
+	if (translatedVec.y + radius > m_arenaSize.y)
 	{
 		outOfBoundsVec.y *= -1;
 	}
@@ -653,12 +1308,12 @@ Vec2 Game::outOfBoundsVec(std::shared_ptr<Entity> entity)
 		outOfBoundsVec.x *= -1;
 	}
 	// Check right
-	if (translatedVec.x + radius > m_window.getSize().x)
+	if (translatedVec.x + radius > m_arenaSize.x)
 	{
 		outOfBoundsVec.x *= -1;
 	}
 
-	if (outOfBoundsVec == entity->cTransform->velocity)
+	if (outOfBoundsVec == tf.velocity(row))
 	{
 		return Vec2(0.0, 0.0);
 	}
@@ -669,5 +1324,5 @@ Vec2 Game::outOfBoundsVec(std::shared_ptr<Entity> entity)
 // Return a random integer within the range provided
 int Game::randInRange(int min, int max)
 {
-	return min + (rand() % (1 + max - min));
+	return m_rng.range(min, max);
 }
\ No newline at end of file
@@ -1,55 +1,166 @@
 #pragma once
 
+#include "Config.h"
 #include "Entity.h"
 #include "EntityManager.h"
+#include "SpatialHash.h"
+#include "ShapeBatch.h"
+#include "Random.h"
+#include "InputLog.h"
+#include "LoadTest.h"
+#include "Profiler.h"
+#include "Scheduler.h"
+#include "TimerWheel.h"
 
 #include <SFML/Graphics.hpp>
 
-struct PlayerConfig { int SR, CR, FR, FG, FB, OR, OG, OB, OT, V; float S; };
-struct EnemyConfig { int SR, CR, OR, OG, OB, OT, VMIN, VMAX, L, SI; float SMIN, SMAX; }; 
-struct BulletConfig { int SR, CR, FR, FG, FB, OR, OG, OB, OT, V, L; float S; };
+// One overlap found by sCollision, applied later by sResolveCollisions
+struct HitEvent
+{
+	enum Kind : uint8_t { Player, Bullet, Special };
+
+	Kind kind;
+	Entity source;  // the player or projectile
+	uint32_t enemy; // index into the enemy bucket, which doesn't change until the next update
+};
+
+// How to run the game, from the command line or the config file
+struct LaunchOptions
+{
+	bool headless = false; // no window, simulation only, as fast as possible
+	long ticks = 0;        // stop a headless run after this many ticks, 0 for no limit
+	uint64_t seed = 0;     // random seed, 0 picks one
+	std::string record;    // write the player's input to this file
+	std::string replay;    // play back input from this file instead of the keyboard and mouse
+	std::string trace;     // export the profiler's trace events here on exit
+	std::string snapshot;     // start from this saved world instead of an empty arena
+	std::string saveSnapshot; // save the world here on exit
+	LoadTestOptions load;     // a scripted bot plays while the spawn rate ramps up
+};
 
 class Game
 {
-	sf::RenderWindow m_window; // The window we will draw to
+	friend class Benchmark; // drives the systems directly on synthetic worlds
+	friend class Snapshot;  // saves and restores the whole world
+	friend class LoadTest;  // reads the profiler and entity counts after every tick
+
+	sf::RenderWindow m_window; // The window we will draw to, never opened when headless
+	LaunchOptions m_options;
+	Vec2 m_arenaSize; // The play area, entities bounce off its edges
+	Vec2 m_viewSize;  // the window's size, the camera sees this much of the arena at zoom 1
+	sf::View m_camera; // follows the player, in arena coordinates
+	float m_zoom = 1.0f; // arena units per pixel, the mouse wheel zooms out to see more
 	EntityManager m_entities; // vector of entities we maintain
 	sf::Font m_font;
 	sf::Text m_text;
+	ShapeCache m_shapes; // geometry shared by every CShape
+	ShapeBatch m_shapeBatch; // every entity's shape, drawn in one go
 	PlayerConfig m_playerConfig;
 	EnemyConfig m_enemyConfig;
 	BulletConfig m_bulletConfig;
+	std::string m_configPath;
+	ConfigWatcher m_configWatcher; // Player, Enemy and Bullet changes are applied while running
 	int m_score = 0;
-	int m_currentFrame = 0;
+	int m_currentFrame = 0; // counts simulation ticks, not rendered frames
+	int m_lastUpdateTick = -1; // the tick EntityManager::update last ran on
 	int m_lastEnemySpawnTime = 0;
 	int m_lastSpecialShot = 0;
+	int m_specialCooldown = 180; // ticks between special weapon shots
 	int m_frameRateLimit = 0;
+	int m_tickRate = 60; // simulation ticks per second
+	int m_maxTicksPerFrame = 5; // how far the simulation may catch up after a slow frame
+	int m_poolSize = 4096; // entities to preallocate storage for
+	int m_threads = 0; // simulation threads, 0 for one per core
+	int m_displayedScore = -1;
+	uint64_t m_tickAllocations = 0; // heap allocations made during the last tick
+	uint64_t m_totalTickAllocations = 0;
 	bool m_paused = false;
 	bool m_running = true;
 
-	std::shared_ptr<Entity> m_player;
+	// Everything random in the simulation comes from m_rng so that a run can be replayed
+	Random m_rng;
+	uint64_t m_seed = 0;
+	InputRecorder m_recorder;
+	InputPlayer m_replay;
+	LoadTest m_loadTest;
+
+	// Per system timings, F3 toggles the overlay and F4 exports a trace
+	Profiler m_profiler;
+	bool m_showProfiler = false;
+
+	// Input from the window, collected every frame and applied to the player on the next tick
+	CInput m_liveInput;
+	std::vector<FireEvent> m_liveFires;
+	std::vector<FireEvent> m_tickFires;
+
+	// Worker threads the systems spread their big loops across
+	Scheduler m_scheduler;
+
+	// Everything timed: lifespans, the next enemy spawn and the special weapon's cooldown.
+	// The spawn and cooldown timers set a flag for the system that acts on it, and only the
+	// latest of each counts, so changing an interval just sets another one.
+	TimerWheel m_timers;
+	std::vector<Timer> m_firedTimers;
+	int m_nextEnemySpawn = 0;
+	int m_specialReadyTick = 0;
+	bool m_enemySpawnDue = false;
+	bool m_specialReady = false;
+
+	// Collision broadphase, rebuilt from the enemies' positions every tick
+	SpatialHash m_enemyGrid;
+	std::vector<float> m_enemyX, m_enemyY, m_enemyR;
+	bool m_enemyGridCurrent = false; // still indexes the enemy bucket, so rendering can use it
+	size_t m_drawnShapes = 0;
+
+	// Enemies a broadphase query turned up, packed for the narrowphase
+	std::vector<uint32_t> m_candidates;
+	std::vector<float> m_candidateX, m_candidateY, m_candidateR;
+
+	// This tick's collisions, and per enemy whether one of them has already been applied
+	std::vector<HitEvent> m_hits;
+	std::vector<uint8_t> m_enemyResolved;
+	std::vector<Entity> m_splitEnemies;
+
+	Entity m_player;
 
 	void init(const std::string& config); // Initialize the GameState with a config file
+	void reloadConfig();
 	void setPaused(bool paused);
+	void tick();
+	void runWindowed();
+	void runHeadless();
+	void pollEvents();
+	uint64_t checksum();
 
 	void sMovement();
 	void sUserInput();
-	void sLifespan();
-	void sRender();
+	void sTimers();
+	void sRender(float alpha);
+	void updateCamera(float alpha);
+	void zoomCamera(float factor);
+	void buildShapeBatch(float alpha);
+	void drawProfiler();
 	void sEnemySpawner();
 	void sCollision();
+	void sResolveCollisions();
 	
+	void addLifespan(Entity entity, int ticks);
+	void scheduleEnemySpawn();
+	void scheduleSpecialReady();
+	void resetTimers();
+
 	void spawnPlayer();
 	void spawnEnemy();
-	void spawnSmallEnemies(std::shared_ptr<Entity> entity);
-	void spawnBullet(std::shared_ptr<Entity> entity, const Vec2& mousePos);
-	void spawnSpecialWeapon(std::shared_ptr<Entity> entity, const Vec2& mousePos);
+	void spawnSmallEnemies(Entity entity);
+	void spawnBullet(Entity entity, const Vec2& mousePos);
+	void spawnSpecialWeapon(Entity entity, const Vec2& mousePos);
 
-	bool goingOutOfBounds(std::shared_ptr<Entity> entity);
-	Vec2 outOfBoundsVec(std::shared_ptr<Entity> entity);
+	bool goingOutOfBounds(size_t row);
+	Vec2 outOfBoundsVec(size_t row);
 	int randInRange(int min, int max);
 
 public:
-	Game(const std::string& config); // constructor, takes in the game config
+	Game(const std::string& config, const LaunchOptions& options = LaunchOptions()); // constructor, takes in the game config
 
 	void run();
 };
\ No newline at end of file
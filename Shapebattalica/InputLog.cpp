@@ -0,0 +1,202 @@
+#include "InputLog.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	void writeBytes(std::vector<uint8_t>& buffer, const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		buffer.insert(buffer.end(), bytes, bytes + size);
+	}
+
+	void writeVarint(std::vector<uint8_t>& buffer, uint32_t value)
+	{
+		while (value >= 0x80)
+		{
+			buffer.push_back((uint8_t)(value | 0x80));
+			value >>= 7;
+		}
+		buffer.push_back((uint8_t)value);
+	}
+
+	uint8_t packInput(const CInput& input)
+	{
+		return (input.up ? 1 : 0) | (input.left ? 2 : 0) | (input.down ? 4 : 0) | (input.right ? 8 : 0) | (input.shoot ? 16 : 0);
+	}
+}
+
+void InputRecorder::open(const std::string& path, uint64_t seed, uint32_t tickRate)
+{
+	m_path = path;
+	m_buffer.clear();
+	// Room for a long session up front, so recording never allocates mid game
+	m_buffer.reserve(1 << 16);
+	m_lastTick = 0;
+	m_lastState = 0;
+	m_open = true;
+
+	writeBytes(m_buffer, "SBIL", 4);
+	writeBytes(m_buffer, &InputLog::VERSION, sizeof(InputLog::VERSION));
+	writeBytes(m_buffer, &seed, sizeof(seed));
+	writeBytes(m_buffer, &tickRate, sizeof(tickRate));
+}
+
+void InputRecorder::writeRecord(int tick, uint8_t flags)
+{
+	writeVarint(m_buffer, (uint32_t)(tick - m_lastTick));
+	m_buffer.push_back(flags);
+	m_lastTick = tick;
+}
+
+void InputRecorder::record(int tick, const CInput& input, const std::vector<FireEvent>& fires)
+{
+	if (!m_open)
+	{
+		return;
+	}
+
+	// Ticks where nothing changed aren't written at all
+	uint8_t state = packInput(input);
+	if (state == m_lastState && fires.empty())
+	{
+		return;
+	}
+
+	size_t count = fires.size() < 255 ? fires.size() : 255;
+	writeRecord(tick, state | (count > 0 ? InputLog::FLAG_EVENTS : 0));
+	if (count > 0)
+	{
+		m_buffer.push_back((uint8_t)count);
+		for (size_t i = 0; i < count; i++)
+		{
+			m_buffer.push_back(fires[i].button);
+			writeBytes(m_buffer, &fires[i].x, sizeof(float));
+			writeBytes(m_buffer, &fires[i].y, sizeof(float));
+		}
+	}
+	m_lastState = state;
+}
+
+bool InputRecorder::finish(int tick)
+{
+	if (!m_open)
+	{
+		return false;
+	}
+	m_open = false;
+
+	writeRecord(tick, m_lastState | InputLog::FLAG_END);
+
+	std::ofstream fout(m_path, std::ios::binary);
+	fout.write((const char*)m_buffer.data(), m_buffer.size());
+	if (!fout)
+	{
+		std::cerr << "Could not write the input log to " << m_path << std::endl;
+		return false;
+	}
+	std::cout << "Recorded " << tick << " ticks of input to " << m_path << std::endl;
+	return true;
+}
+
+bool InputPlayer::open(const std::string& path)
+{
+	std::ifstream fin(path, std::ios::binary);
+	if (!fin)
+	{
+		std::cerr << "Could not open the input log " << path << std::endl;
+		return false;
+	}
+	m_data.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+
+	const size_t headerSize = 4 + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t);
+	uint32_t version = 0;
+	if (m_data.size() < headerSize || std::memcmp(m_data.data(), "SBIL", 4) != 0)
+	{
+		std::cerr << path << " is not an input log" << std::endl;
+		return false;
+	}
+	std::memcpy(&version, &m_data[4], sizeof(version));
+	if (version != InputLog::VERSION)
+	{
+		std::cerr << path << " is input log version " << version << ", expected " << InputLog::VERSION << std::endl;
+		return false;
+	}
+	std::memcpy(&m_seed, &m_data[8], sizeof(m_seed));
+	std::memcpy(&m_tickRate, &m_data[16], sizeof(m_tickRate));
+
+	m_cursor = headerSize;
+	m_nextTick = 0;
+	m_state = 0;
+	m_finished = false;
+	m_open = readNext();
+	return m_open;
+}
+
+// Reads the next record's tick and flags, leaving the cursor on its events
+bool InputPlayer::readNext()
+{
+	uint32_t delta = 0;
+	for (int shift = 0; m_cursor < m_data.size(); shift += 7)
+	{
+		uint8_t byte = m_data[m_cursor++];
+		delta |= (uint32_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+		{
+			if (m_cursor >= m_data.size())
+			{
+				break;
+			}
+			m_nextTick += delta;
+			m_nextFlags = m_data[m_cursor++];
+			return true;
+		}
+	}
+
+	// A truncated log just ends where the data does
+	std::cerr << "Input log ended early" << std::endl;
+	m_nextFlags = InputLog::FLAG_END;
+	return false;
+}
+
+bool InputPlayer::read(int tick, CInput& input, std::vector<FireEvent>& fires)
+{
+	fires.clear();
+	while (!m_finished && m_nextTick <= tick)
+	{
+		if (m_nextFlags & InputLog::FLAG_END)
+		{
+			m_finished = true;
+			break;
+		}
+
+		m_state = m_nextFlags & 0x1F;
+		if ((m_nextFlags & InputLog::FLAG_EVENTS) && m_cursor < m_data.size())
+		{
+			uint8_t count = m_data[m_cursor++];
+			const size_t eventSize = 1 + 2 * sizeof(float);
+			for (uint8_t i = 0; i < count && m_cursor + eventSize <= m_data.size(); i++)
+			{
+				FireEvent fire;
+				fire.button = m_data[m_cursor];
+				std::memcpy(&fire.x, &m_data[m_cursor + 1], sizeof(float));
+				std::memcpy(&fire.y, &m_data[m_cursor + 1 + sizeof(float)], sizeof(float));
+				fires.push_back(fire);
+				m_cursor += eventSize;
+			}
+		}
+
+		if (!readNext())
+		{
+			m_finished = true;
+		}
+	}
+
+	input.up = (m_state & 1) != 0;
+	input.left = (m_state & 2) != 0;
+	input.down = (m_state & 4) != 0;
+	input.right = (m_state & 8) != 0;
+	input.shoot = (m_state & 16) != 0;
+	return !m_finished;
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Components.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A mouse click that fires a weapon, in world coordinates
+struct FireEvent
+{
+	uint8_t button = 0; // sf::Mouse::Button
+	float x = 0;
+	float y = 0;
+};
+
+// Binary log of the player's input per simulation tick, so a run can be replayed exactly.
+//
+// Header: "SBIL", uint32 version, uint64 seed, uint32 tick rate.
+// Then one record per tick where the input changed or a weapon was fired:
+//   varint ticks since the previous record, uint8 flags (bits 0-4 up/left/down/right/shoot),
+//   and if FLAG_EVENTS is set, uint8 count followed by count x (uint8 button, float x, float y).
+// The last record has FLAG_END set and marks the tick the recording stopped on.
+namespace InputLog
+{
+	constexpr uint32_t VERSION = 1;
+	constexpr uint8_t FLAG_EVENTS = 1 << 6;
+	constexpr uint8_t FLAG_END = 1 << 7;
+}
+
+class InputRecorder
+{
+	std::string m_path;
+	std::vector<uint8_t> m_buffer;
+	int m_lastTick = 0;
+	uint8_t m_lastState = 0;
+	bool m_open = false;
+
+	void writeRecord(int tick, uint8_t flags);
+
+public:
+	// Starts buffering a new log, it's written out by finish()
+	void open(const std::string& path, uint64_t seed, uint32_t tickRate);
+	bool isOpen() const { return m_open; }
+
+	void record(int tick, const CInput& input, const std::vector<FireEvent>& fires);
+
+	// Writes the log in one go, returns false if the file couldn't be written
+	bool finish(int tick);
+};
+
+class InputPlayer
+{
+	std::vector<uint8_t> m_data;
+	size_t m_cursor = 0;
+	int m_nextTick = 0;
+	uint8_t m_nextFlags = 0;
+	uint8_t m_state = 0;
+	uint64_t m_seed = 0;
+	uint32_t m_tickRate = 0;
+	bool m_open = false;
+	bool m_finished = false;
+
+	bool readNext();
+
+public:
+	// Reads the whole log into memory, returns false if it's missing or not a log
+	bool open(const std::string& path);
+	bool isOpen() const { return m_open; }
+
+	uint64_t seed() const { return m_seed; }
+	uint32_t tickRate() const { return m_tickRate; }
+
+	// Fills in the input for the given tick, ticks must be asked for in increasing order.
+	// Returns false once the recording has ended.
+	bool read(int tick, CInput& input, std::vector<FireEvent>& fires);
+};
\ No newline at end of file
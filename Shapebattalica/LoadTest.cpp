@@ -0,0 +1,300 @@
+#include "LoadTest.h"
+#include "Game.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <math.h>
+
+LoadBot::LoadBot(Target target, float shotsPerTick, bool specials, uint64_t seed)
+	: m_rng(seed), m_target(target), m_shotsPerTick(shotsPerTick), m_specials(specials) {}
+
+bool LoadBot::parseTarget(const std::string& name, Target& target)
+{
+	if (name == "nearest")
+	{
+		target = Target::Nearest;
+	}
+	else if (name == "random")
+	{
+		target = Target::Random;
+	}
+	else if (name == "score")
+	{
+		target = Target::Score;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+void LoadBot::pickTarget(EntityManager& entities, const Vec2& from)
+{
+	// The enemy bucket may still hold enemies that died last tick, they're skipped
+	auto& tf = entities.transforms();
+	const EntityVec& enemies = entities.getEntities(Tag::Enemy);
+	m_current = Entity();
+	m_threatened = false;
+
+	float nearestSq = 0;
+	int bestScore = -1;
+	for (Entity e : enemies)
+	{
+		if (!entities.isActive(e))
+		{
+			continue;
+		}
+		const size_t row = entities.row(e);
+		float distSq = tf.pos(row).distSq(from);
+		if (!m_threatened || distSq < nearestSq)
+		{
+			nearestSq = distSq;
+			m_threat = tf.pos(row);
+			m_threatened = true;
+			if (m_target == Target::Nearest)
+			{
+				m_current = e;
+			}
+		}
+		if (m_target == Target::Score && entities.get<CScore>(row).score > bestScore)
+		{
+			bestScore = entities.get<CScore>(row).score;
+			m_current = e;
+		}
+	}
+
+	if (m_target == Target::Random && m_threatened)
+	{
+		// Retry a few times in case we land on a dead one
+		for (int attempt = 0; attempt < 4 && m_current == Entity(); attempt++)
+		{
+			Entity e = enemies[m_rng.range(0, (int)enemies.size() - 1)];
+			if (entities.isActive(e))
+			{
+				m_current = e;
+			}
+		}
+	}
+}
+
+void LoadBot::act(EntityManager& entities, Entity player, const Vec2& arena, int tickRate, CInput& input, std::vector<FireEvent>& fires)
+{
+	const Vec2 pos = entities.transforms().pos(entities.row(player));
+
+	if (--m_ticksToPick <= 0 || !entities.isActive(m_current))
+	{
+		pickTarget(entities, pos);
+		m_ticksToPick = std::max(1, tickRate / 8);
+	}
+
+	// Run from the closest enemy while it's within a few hundred pixels, otherwise wander,
+	// picking a new direction every second or so
+	Vec2 heading;
+	const float fleeDistance = 200.0f;
+	if (m_threatened && m_threat.distSq(pos) < fleeDistance * fleeDistance)
+	{
+		heading = pos - m_threat;
+	}
+	else
+	{
+		if (--m_ticksToTurn <= 0)
+		{
+			m_wander = Vec2::fromAngleAndSpeed((float)m_rng.range(0, 359) * 3.1415926f / 180.0f, 1.0f);
+			m_ticksToTurn = m_rng.range(tickRate / 2, tickRate * 2);
+		}
+		heading = m_wander;
+
+		// Head back towards the middle rather than grinding along an edge
+		const float margin = 64.0f;
+		if (pos.x < margin || pos.x > arena.x - margin || pos.y < margin || pos.y > arena.y - margin)
+		{
+			heading = arena * 0.5f - pos;
+		}
+	}
+
+	input = CInput();
+	input.left = heading.x < -0.1f * fabsf(heading.y);
+	input.right = heading.x > 0.1f * fabsf(heading.y);
+	input.up = heading.y < -0.1f * fabsf(heading.x);
+	input.down = heading.y > 0.1f * fabsf(heading.x);
+
+	if (m_current == Entity())
+	{
+		return;
+	}
+
+	const Vec2 target = entities.transforms().pos(entities.row(m_current));
+	FireEvent fire;
+	fire.x = target.x;
+	fire.y = target.y;
+
+	// Fractional rates carry over, so 10 shots a second at 60 ticks a second is one every 6 ticks
+	m_shotCredit += m_shotsPerTick;
+	while (m_shotCredit >= 1.0f)
+	{
+		fire.button = (uint8_t)sf::Mouse::Left;
+		fires.push_back(fire);
+		m_shotCredit -= 1.0f;
+	}
+
+	// sUserInput ignores this while the special weapon is recharging
+	if (m_specials)
+	{
+		fire.button = (uint8_t)sf::Mouse::Right;
+		fires.push_back(fire);
+	}
+}
+
+bool LoadTest::start(const LoadTestOptions& options, uint64_t seed, int tickRate)
+{
+	m_options = options;
+	LoadBot::Target target;
+	if (!LoadBot::parseTarget(options.target, target))
+	{
+		std::cerr << "Unknown load test target " << options.target << ", expected nearest, random or score" << std::endl;
+		return false;
+	}
+	if (options.fireRate < 0 || options.spawnMultiplier <= 0 || options.ramp < 1 || options.levels < 1 || options.levelTicks < 1)
+	{
+		std::cerr << "Load test options out of range: the fire rate can't be negative, the spawn multiplier must be above 0, "
+			"the ramp at least 1, and there must be at least one level of at least one tick" << std::endl;
+		return false;
+	}
+
+	// The bot's numbers are a different sequence from the game's, but still come from the seed
+	m_bot = LoadBot(target, options.fireRate / tickRate, options.specials, seed ^ 0x9e3779b97f4a7c15ULL);
+	m_enabled = true;
+	m_budgetMs = 1000.0f / tickRate;
+	m_spawnMultiplier = options.spawnMultiplier;
+	m_levels.clear();
+	m_ticks = 0;
+
+	std::cout << "Load test: " << options.levels << " levels of " << options.levelTicks << " ticks, spawn rate x" << options.spawnMultiplier
+		<< " rising x" << options.ramp << " per level, bot targets " << options.target << std::endl;
+	return true;
+}
+
+bool LoadTest::afterTick(Game& game)
+{
+	const size_t entities = game.m_entities.size();
+	if (m_ticks == 0)
+	{
+		// Start timing the level from here
+		game.m_profiler.resetTotals();
+		m_minEntities = entities;
+		m_maxEntities = entities;
+		m_entityTicks = 0;
+		m_allocations = 0;
+	}
+	m_ticks++;
+	m_minEntities = std::min(m_minEntities, entities);
+	m_maxEntities = std::max(m_maxEntities, entities);
+	m_entityTicks += (double)entities;
+	m_allocations += game.m_tickAllocations;
+
+	if (m_ticks < m_options.levelTicks)
+	{
+		return true;
+	}
+
+	Level level;
+	level.level = (int)m_levels.size();
+	level.spawnMultiplier = m_spawnMultiplier;
+	level.minEntities = m_minEntities;
+	level.maxEntities = m_maxEntities;
+	level.meanEntities = m_entityTicks / m_ticks;
+	level.allocationsPerTick = (double)m_allocations / m_ticks;
+
+	// Totals are divided by ticks rather than calls, so every system's cost is per tick
+	for (const Profiler::Stats& stats : game.m_profiler.stats())
+	{
+		if (stats.calls == 0)
+		{
+			continue;
+		}
+		if (stats.name == "tick")
+		{
+			level.tickMs = stats.total / stats.calls;
+			level.tickP99Ms = stats.p99;
+		}
+		else if (stats.name == "frame")
+		{
+			level.frameMs = stats.total / stats.calls;
+		}
+		else
+		{
+			level.systems.push_back({ stats.name, stats.total / m_ticks });
+		}
+	}
+	std::sort(level.systems.begin(), level.systems.end(), [](const System& a, const System& b) { return a.msPerTick > b.msPerTick; });
+
+	std::printf("level %2d  spawn x%-8g entities %7.0f (%zu-%zu)  tick %8.3f ms  p99 %8.3f ms  frame %8.3f ms  allocations/tick %.2f\n",
+		level.level, level.spawnMultiplier, level.meanEntities, level.minEntities, level.maxEntities,
+		level.tickMs, level.tickP99Ms, level.frameMs, level.allocationsPerTick);
+	for (size_t i = 0; i < level.systems.size() && i < 4; i++)
+	{
+		std::printf("          %-24s %8.3f ms/tick\n", level.systems[i].name.c_str(), level.systems[i].msPerTick);
+	}
+
+	m_levels.push_back(level);
+	m_ticks = 0;
+	m_spawnMultiplier *= m_options.ramp;
+	game.scheduleEnemySpawn();
+
+	// Far enough past the budget that the game is unplayable, more levels won't tell us anything
+	return (int)m_levels.size() < m_options.levels && level.tickMs < m_budgetMs * 10;
+}
+
+void LoadTest::finish()
+{
+	if (!m_enabled)
+	{
+		return;
+	}
+
+	// Where the simulation stopped keeping up with real time
+	auto over = std::find_if(m_levels.begin(), m_levels.end(), [&](const Level& level) { return level.tickMs > m_budgetMs; });
+	if (over == m_levels.end())
+	{
+		std::cout << "Every level stayed within the " << m_budgetMs << " ms tick budget" << std::endl;
+	}
+	else
+	{
+		std::cout << "Over the " << m_budgetMs << " ms tick budget from level " << over->level << ", around "
+			<< (size_t)over->meanEntities << " entities, where " << (over->systems.empty() ? "nothing" : over->systems[0].name)
+			<< " cost the most" << std::endl;
+	}
+
+	writeJson(m_options.report);
+}
+
+bool LoadTest::writeJson(const std::string& path) const
+{
+	std::ofstream fout(path);
+	if (!fout)
+	{
+		std::cerr << "Could not write the load test report to " << path << std::endl;
+		return false;
+	}
+
+	fout << "[\n";
+	for (size_t i = 0; i < m_levels.size(); i++)
+	{
+		const Level& l = m_levels[i];
+		fout << "  {\"level\": " << l.level << ", \"spawn_multiplier\": " << l.spawnMultiplier
+			<< ", \"entities_mean\": " << l.meanEntities << ", \"entities_min\": " << l.minEntities << ", \"entities_max\": " << l.maxEntities
+			<< ", \"tick_ms\": " << l.tickMs << ", \"tick_p99_ms\": " << l.tickP99Ms << ", \"frame_ms\": " << l.frameMs
+			<< ", \"allocations_per_tick\": " << l.allocationsPerTick << ", \"systems_ms_per_tick\": {";
+		for (size_t s = 0; s < l.systems.size(); s++)
+		{
+			fout << (s ? ", " : "") << "\"" << l.systems[s].name << "\": " << l.systems[s].msPerTick;
+		}
+		fout << "}}" << (i + 1 < m_levels.size() ? ",\n" : "\n");
+	}
+	fout << "]\n";
+
+	std::cout << "Wrote " << m_levels.size() << " load levels to " << path << std::endl;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Entity.h"
+#include "InputLog.h"
+#include "Random.h"
+#include "Vec2.h"
+#include <string>
+#include <vector>
+
+class EntityManager;
+class Game;
+
+// How to run a load test, from the command line. A load test is off unless target is set.
+struct LoadTestOptions
+{
+	std::string target;        // the bot's target policy: "nearest", "random" or "score"
+	float fireRate = 10;       // bullets the bot fires per second
+	bool specials = true;      // fire the special weapon whenever its cooldown allows
+	float spawnMultiplier = 1; // enemy spawn rate for the first level, in multiples of the config's SI
+	float ramp = 2;            // each level multiplies the spawn rate by this much
+	int levels = 12;           // stop after this many levels
+	int levelTicks = 600;      // ticks per level
+	std::string report = "loadtest.json";
+};
+
+// Plays in place of a person: keeps away from the closest enemy, wanders otherwise, and
+// shoots at a target picked by its policy. It has its own random numbers seeded from the
+// game's, so a load test with the same seed and options plays out the same every time.
+class LoadBot
+{
+public:
+	enum class Target
+	{
+		Nearest, // the closest enemy
+		Random,  // any enemy, chosen at random
+		Score    // the enemy worth the most, the big ones, which split into fragments
+	};
+
+private:
+	Random m_rng;
+	Target m_target = Target::Nearest;
+	float m_shotsPerTick = 0;
+	float m_shotCredit = 0;
+	bool m_specials = true;
+
+	// Targets are only picked a few times a second, looking through every enemy isn't free
+	Entity m_current;
+	Vec2 m_threat;       // the closest enemy as of the last pick
+	bool m_threatened = false;
+	int m_ticksToPick = 0;
+	Vec2 m_wander;
+	int m_ticksToTurn = 0;
+
+	void pickTarget(EntityManager& entities, const Vec2& from);
+
+public:
+	LoadBot() {}
+	LoadBot(Target target, float shotsPerTick, bool specials, uint64_t seed);
+
+	static bool parseTarget(const std::string& name, Target& target);
+
+	// Decides this tick's movement and shots for the player
+	void act(EntityManager& entities, Entity player, const Vec2& arena, int tickRate, CInput& input, std::vector<FireEvent>& fires);
+};
+
+// Raises the enemy spawn rate in levels of a fixed number of ticks, and records what each
+// level cost: tick and frame time, every profiled system, entity counts and allocations.
+// The levels are printed as they finish and written to a JSON report at the end. The test
+// ends after the last level, or as soon as a level averages ten ticks' worth of time per tick.
+class LoadTest
+{
+	struct System
+	{
+		std::string name;
+		double msPerTick = 0;
+	};
+
+	struct Level
+	{
+		int level = 0;
+		float spawnMultiplier = 0;
+		size_t minEntities = 0;
+		size_t maxEntities = 0;
+		double meanEntities = 0;
+		double tickMs = 0;    // mean
+		double tickP99Ms = 0; // over the level's last Profiler::SAMPLES ticks
+		double frameMs = 0;   // mean, only when there's a window
+		double allocationsPerTick = 0;
+		std::vector<System> systems;
+	};
+
+	LoadTestOptions m_options;
+	LoadBot m_bot;
+	bool m_enabled = false;
+	float m_budgetMs = 0;
+	float m_spawnMultiplier = 1;
+	std::vector<Level> m_levels;
+
+	// The level in progress
+	int m_ticks = 0;
+	size_t m_minEntities = 0;
+	size_t m_maxEntities = 0;
+	double m_entityTicks = 0;
+	uint64_t m_allocations = 0;
+
+	bool writeJson(const std::string& path) const;
+
+public:
+	// Returns false if the options don't make sense
+	bool start(const LoadTestOptions& options, uint64_t seed, int tickRate);
+
+	bool enabled() const { return m_enabled; }
+	LoadBot& bot() { return m_bot; }
+
+	// How many times faster than the config says enemies should spawn, 1 outside a load test
+	float spawnMultiplier() const { return m_spawnMultiplier; }
+
+	// Called at the end of every tick. Returns false once the test is over.
+	bool afterTick(Game& game);
+
+	// Reports on the levels run so far
+	void finish();
+};
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include "MovementKernel.h"
+#include "Random.h"
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// The scalar path is the reference, the SIMD paths do exactly the same float operations in lanes.
+// An axis flips when the next position pokes out of exactly one edge, like outOfBoundsVec.
+static void runScalar(const MovementKernel::Lanes& l, size_t begin, size_t end, float width, float height, float spin)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		float r = l.bounceRadius[i];
+		float vx = l.velX[i];
+		float vy = l.velY[i];
+		float tx = l.posX[i] + vx;
+		float ty = l.posY[i] + vy;
+		bool bounces = r >= 0.0f;
+		bool flipX = bounces && ((tx - r < 0.0f) != (tx + r > width));
+		bool flipY = bounces && ((ty - r < 0.0f) != (ty + r > height));
+		vx = flipX ? -vx : vx;
+		vy = flipY ? -vy : vy;
+		l.velX[i] = vx;
+		l.velY[i] = vy;
+		l.posX[i] += vx;
+		l.posY[i] += vy;
+		l.angle[i] += spin;
+	}
+}
+
+#ifdef SIMD_X86
+SIMD_TARGET_SSE static void runSSE(const MovementKernel::Lanes& l, size_t begin, size_t end, float width, float height, float spin)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 w = _mm_set1_ps(width);
+	const __m128 h = _mm_set1_ps(height);
+	const __m128 s = _mm_set1_ps(spin);
+
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 r = _mm_loadu_ps(l.bounceRadius + i);
+		__m128 px = _mm_loadu_ps(l.posX + i);
+		__m128 py = _mm_loadu_ps(l.posY + i);
+		__m128 vx = _mm_loadu_ps(l.velX + i);
+		__m128 vy = _mm_loadu_ps(l.velY + i);
+		__m128 bounces = _mm_cmpge_ps(r, zero);
+
+		// Flip masks are all ones in lanes that hit one edge, xor-ing the sign bit negates those lanes
+		__m128 tx = _mm_add_ps(px, vx);
+		__m128 ty = _mm_add_ps(py, vy);
+		__m128 flipX = _mm_xor_ps(_mm_cmplt_ps(_mm_sub_ps(tx, r), zero), _mm_cmpgt_ps(_mm_add_ps(tx, r), w));
+		__m128 flipY = _mm_xor_ps(_mm_cmplt_ps(_mm_sub_ps(ty, r), zero), _mm_cmpgt_ps(_mm_add_ps(ty, r), h));
+		vx = _mm_xor_ps(vx, _mm_and_ps(_mm_and_ps(flipX, bounces), sign));
+		vy = _mm_xor_ps(vy, _mm_and_ps(_mm_and_ps(flipY, bounces), sign));
+
+		_mm_storeu_ps(l.velX + i, vx);
+		_mm_storeu_ps(l.velY + i, vy);
+		_mm_storeu_ps(l.posX + i, _mm_add_ps(px, vx));
+		_mm_storeu_ps(l.posY + i, _mm_add_ps(py, vy));
+		_mm_storeu_ps(l.angle + i, _mm_add_ps(_mm_loadu_ps(l.angle + i), s));
+	}
+
+	runScalar(l, i, end, width, height, spin);
+}
+
+SIMD_TARGET_AVX2 static void runAVX2(const MovementKernel::Lanes& l, size_t begin, size_t end, float width, float height, float spin)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 sign = _mm256_set1_ps(-0.0f);
+	const __m256 w = _mm256_set1_ps(width);
+	const __m256 h = _mm256_set1_ps(height);
+	const __m256 s = _mm256_set1_ps(spin);
+
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 r = _mm256_loadu_ps(l.bounceRadius + i);
+		__m256 px = _mm256_loadu_ps(l.posX + i);
+		__m256 py = _mm256_loadu_ps(l.posY + i);
+		__m256 vx = _mm256_loadu_ps(l.velX + i);
+		__m256 vy = _mm256_loadu_ps(l.velY + i);
+		__m256 bounces = _mm256_cmp_ps(r, zero, _CMP_GE_OQ);
+
+		__m256 tx = _mm256_add_ps(px, vx);
+		__m256 ty = _mm256_add_ps(py, vy);
+		__m256 flipX = _mm256_xor_ps(_mm256_cmp_ps(_mm256_sub_ps(tx, r), zero, _CMP_LT_OQ),
+			_mm256_cmp_ps(_mm256_add_ps(tx, r), w, _CMP_GT_OQ));
+		__m256 flipY = _mm256_xor_ps(_mm256_cmp_ps(_mm256_sub_ps(ty, r), zero, _CMP_LT_OQ),
+			_mm256_cmp_ps(_mm256_add_ps(ty, r), h, _CMP_GT_OQ));
+		vx = _mm256_xor_ps(vx, _mm256_and_ps(_mm256_and_ps(flipX, bounces), sign));
+		vy = _mm256_xor_ps(vy, _mm256_and_ps(_mm256_and_ps(flipY, bounces), sign));
+
+		_mm256_storeu_ps(l.velX + i, vx);
+		_mm256_storeu_ps(l.velY + i, vy);
+		_mm256_storeu_ps(l.posX + i, _mm256_add_ps(px, vx));
+		_mm256_storeu_ps(l.posY + i, _mm256_add_ps(py, vy));
+		_mm256_storeu_ps(l.angle + i, _mm256_add_ps(_mm256_loadu_ps(l.angle + i), s));
+	}
+
+	runScalar(l, i, end, width, height, spin);
+}
+#endif
+
+void MovementKernel::run(const Lanes& lanes, size_t begin, size_t end, float width, float height, float spin)
+{
+	run(Simd::best(), lanes, begin, end, width, height, spin);
+}
+
+void MovementKernel::run(Simd::Path path, const Lanes& lanes, size_t begin, size_t end, float width, float height, float spin)
+{
+#ifdef SIMD_X86
+	if (path == Simd::Path::AVX2 && Simd::supported(Simd::Path::AVX2))
+	{
+		runAVX2(lanes, begin, end, width, height, spin);
+		return;
+	}
+	if (path == Simd::Path::SSE && Simd::supported(Simd::Path::SSE))
+	{
+		runSSE(lanes, begin, end, width, height, spin);
+		return;
+	}
+#endif
+	runScalar(lanes, begin, end, width, height, spin);
+}
+
+void MovementKernel::test()
+{
+	// An odd count so every path also runs its scalar tail
+	const size_t count = 1027;
+	const float width = 1280.0f;
+	const float height = 720.0f;
+
+	struct Arrays
+	{
+		std::vector<float> posX, posY, velX, velY, angle, radius;
+
+		Lanes lanes()
+		{
+			return { posX.data(), posY.data(), velX.data(), velY.data(), angle.data(), radius.data() };
+		}
+	};
+
+	Arrays input;
+	Random rng(12345);
+	auto uniform = [&rng](float min, float max) { return min + (max - min) * (rng.next() / 4294967296.0f); };
+	for (size_t i = 0; i < count; i++)
+	{
+		input.posX.push_back(uniform(-50.0f, width + 50.0f));
+		input.posY.push_back(uniform(-50.0f, height + 50.0f));
+		input.velX.push_back(uniform(-10.0f, 10.0f));
+		input.velY.push_back(uniform(-10.0f, 10.0f));
+		input.angle.push_back(uniform(0.0f, 360.0f));
+
+		// A mix of entities that don't bounce, points, and ones that touch both edges at once
+		switch (i % 4)
+		{
+		case 0: input.radius.push_back(-1.0f); break;
+		case 1: input.radius.push_back(0.0f); break;
+		case 2: input.radius.push_back(uniform(1.0f, 40.0f)); break;
+		default: input.radius.push_back(uniform(300.0f, 800.0f)); break;
+		}
+
+		// Zero speeds and positions landing exactly on an edge are where the compares must agree
+		if (i % 7 == 0)
+		{
+			input.velY[i] = (i % 14 == 0) ? 0.0f : -0.0f;
+		}
+		if (i % 11 == 0)
+		{
+			input.posX[i] = input.radius[i] - input.velX[i];
+		}
+	}
+
+	Arrays expected = input;
+	runScalar(expected.lanes(), 0, count, width, height, 1.0f);
+
+	for (int p = 0; p < (int)Simd::Path::Count; p++)
+	{
+		Simd::Path path = (Simd::Path)p;
+		if (!Simd::supported(path))
+		{
+			std::cout << "MovementKernel " << Simd::name(path) << ": not supported by this CPU" << std::endl;
+			continue;
+		}
+
+		Arrays actual = input;
+		run(path, actual.lanes(), 0, count, width, height, 1.0f);
+
+		bool same = std::memcmp(actual.posX.data(), expected.posX.data(), count * sizeof(float)) == 0 &&
+			std::memcmp(actual.posY.data(), expected.posY.data(), count * sizeof(float)) == 0 &&
+			std::memcmp(actual.velX.data(), expected.velX.data(), count * sizeof(float)) == 0 &&
+			std::memcmp(actual.velY.data(), expected.velY.data(), count * sizeof(float)) == 0 &&
+			std::memcmp(actual.angle.data(), expected.angle.data(), count * sizeof(float)) == 0;
+		std::cout << "MovementKernel " << Simd::name(path) << " == Scalar: " << (same ? "yes" : "NO") << std::endl;
+	}
+	std::cout << "MovementKernel using " << Simd::name(Simd::best()) << std::endl;
+}
\ No newline at end of file
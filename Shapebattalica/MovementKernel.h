@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Simd.h"
+#include <cstddef>
+
+// Moves packed transform lanes one tick: entities with a bounce radius reflect off the
+// arena's edges, then everything advances by its velocity and spins. There are no
+// per-entity branches, so it runs 4 (SSE) or 8 (AVX2) entities at a time.
+// The widest path the CPU supports is used, and every path gives exactly the same
+// bits as the scalar one.
+class MovementKernel
+{
+public:
+	// The arrays to work on, all indexed by row
+	struct Lanes
+	{
+		float* posX;
+		float* posY;
+		float* velX;
+		float* velY;
+		float* angle;
+		const float* bounceRadius; // negative means the entity doesn't bounce
+	};
+
+	// Reflects and integrates rows [begin, end) inside a width x height arena
+	static void run(const Lanes& lanes, size_t begin, size_t end, float width, float height, float spin);
+	static void run(Simd::Path path, const Lanes& lanes, size_t begin, size_t end, float width, float height, float spin);
+
+	// Runs every supported path over the same random lanes and compares them to the scalar path
+	static void test();
+};
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "Narrowphase.h"
+#include "Random.h"
+#include <iostream>
+#include <vector>
+
+// Touching circles don't count as overlapping, like the old dist() < r1 + r2 test
+static uint64_t overlapsScalar(float x, float y, float r, const float* cx, const float* cy, const float* cr, size_t begin, size_t count)
+{
+	uint64_t hits = 0;
+	for (size_t i = begin; i < count; i++)
+	{
+		float dx = cx[i] - x;
+		float dy = cy[i] - y;
+		float reach = cr[i] + r;
+		if (dx * dx + dy * dy < reach * reach)
+		{
+			hits |= 1ULL << i;
+		}
+	}
+	return hits;
+}
+
+#ifdef SIMD_X86
+SIMD_TARGET_SSE static uint64_t overlapsSSE(float x, float y, float r, const float* cx, const float* cy, const float* cr, size_t count)
+{
+	const __m128 qx = _mm_set1_ps(x);
+	const __m128 qy = _mm_set1_ps(y);
+	const __m128 qr = _mm_set1_ps(r);
+
+	uint64_t hits = 0;
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(cx + i), qx);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(cy + i), qy);
+		__m128 reach = _mm_add_ps(_mm_loadu_ps(cr + i), qr);
+		__m128 distSq = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+		hits |= (uint64_t)_mm_movemask_ps(_mm_cmplt_ps(distSq, _mm_mul_ps(reach, reach))) << i;
+	}
+
+	return hits | overlapsScalar(x, y, r, cx, cy, cr, i, count);
+}
+
+SIMD_TARGET_AVX2 static uint64_t overlapsAVX2(float x, float y, float r, const float* cx, const float* cy, const float* cr, size_t count)
+{
+	const __m256 qx = _mm256_set1_ps(x);
+	const __m256 qy = _mm256_set1_ps(y);
+	const __m256 qr = _mm256_set1_ps(r);
+
+	uint64_t hits = 0;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(cx + i), qx);
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(cy + i), qy);
+		__m256 reach = _mm256_add_ps(_mm256_loadu_ps(cr + i), qr);
+		__m256 distSq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+		hits |= (uint64_t)_mm256_movemask_ps(_mm256_cmp_ps(distSq, _mm256_mul_ps(reach, reach), _CMP_LT_OQ)) << i;
+	}
+
+	return hits | overlapsScalar(x, y, r, cx, cy, cr, i, count);
+}
+#endif
+
+uint64_t Narrowphase::overlaps(float x, float y, float r, const float* cx, const float* cy, const float* cr, size_t count)
+{
+	return overlaps(Simd::best(), x, y, r, cx, cy, cr, count);
+}
+
+uint64_t Narrowphase::overlaps(Simd::Path path, float x, float y, float r, const float* cx, const float* cy, const float* cr, size_t count)
+{
+#ifdef SIMD_X86
+	if (path == Simd::Path::AVX2 && Simd::supported(Simd::Path::AVX2))
+	{
+		return overlapsAVX2(x, y, r, cx, cy, cr, count);
+	}
+	if (path == Simd::Path::SSE && Simd::supported(Simd::Path::SSE))
+	{
+		return overlapsSSE(x, y, r, cx, cy, cr, count);
+	}
+#endif
+	return overlapsScalar(x, y, r, cx, cy, cr, 0, count);
+}
+
+void Narrowphase::test()
+{
+	Random rng(54321);
+	auto uniform = [&rng](float min, float max) { return min + (max - min) * (rng.next() / 4294967296.0f); };
+
+	// Batches of every size, so the SIMD paths' scalar tails are covered too
+	std::vector<float> cx(BATCH), cy(BATCH), cr(BATCH);
+	int mismatches[(int)Simd::Path::Count] = {};
+	int hits = 0;
+	for (size_t count = 0; count <= BATCH; count++)
+	{
+		float x = uniform(0.0f, 200.0f);
+		float y = uniform(0.0f, 200.0f);
+		float r = uniform(4.0f, 32.0f);
+		for (size_t i = 0; i < count; i++)
+		{
+			cx[i] = uniform(0.0f, 200.0f);
+			cy[i] = uniform(0.0f, 200.0f);
+			cr[i] = uniform(4.0f, 32.0f);
+		}
+
+		uint64_t expected = overlapsScalar(x, y, r, cx.data(), cy.data(), cr.data(), 0, count);
+		hits += (int)(expected != 0);
+		for (int p = 0; p < (int)Simd::Path::Count; p++)
+		{
+			if (Simd::supported((Simd::Path)p) && overlaps((Simd::Path)p, x, y, r, cx.data(), cy.data(), cr.data(), count) != expected)
+			{
+				mismatches[p]++;
+			}
+		}
+	}
+
+	for (int p = 0; p < (int)Simd::Path::Count; p++)
+	{
+		if (Simd::supported((Simd::Path)p))
+		{
+			std::cout << "Narrowphase " << Simd::name((Simd::Path)p) << " mismatches: " << mismatches[p] << " == 0" << std::endl;
+		}
+	}
+	std::cout << "Narrowphase batches with hits: " << hits << " > 0" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Simd.h"
+#include <cstddef>
+#include <cstdint>
+
+// Exact circle overlap tests for the candidates a broadphase query turned up.
+// One query circle is tested against up to 64 packed candidates at a time, comparing
+// squared distances so there is no square root, and the result is a bitmask of hits.
+class Narrowphase
+{
+public:
+	static constexpr size_t BATCH = 64;
+
+	// Bit i is set when candidate i (at cx[i], cy[i] with radius cr[i]) overlaps the circle
+	// at (x, y) with radius r. count must be at most BATCH.
+	static uint64_t overlaps(float x, float y, float r, const float* cx, const float* cy, const float* cr, size_t count);
+	static uint64_t overlaps(Simd::Path path, float x, float y, float r, const float* cx, const float* cy, const float* cr, size_t count);
+
+	// Compares every supported path against the scalar one on random candidates
+	static void test();
+};
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+Profiler::Profiler()
+	: m_events(EVENTS) {}
+
+Profiler::Scope::Scope(Profiler& profiler, const char* name)
+	: m_profiler(profiler), m_section(profiler.sectionIndex(name)), m_start(Clock::now()) {}
+
+Profiler::Scope::~Scope()
+{
+	m_profiler.record(m_section, m_start, Clock::now());
+}
+
+// Gives each thread a small stable number for the trace's tid
+static uint32_t threadNumber()
+{
+	static std::atomic<uint32_t> next{ 1 };
+	thread_local uint32_t number = next++;
+	return number;
+}
+
+uint32_t Profiler::sectionIndex(const char* name)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Names are almost always the same string literal, so compare pointers before contents.
+	// There are only a handful of sections, a linear search is plenty.
+	for (size_t i = 0; i < m_sections.size(); i++)
+	{
+		if (m_sections[i].name == name || std::strcmp(m_sections[i].name, name) == 0)
+		{
+			return (uint32_t)i;
+		}
+	}
+
+	Section section;
+	section.name = name;
+	section.samples.resize(SAMPLES);
+	m_sections.push_back(section);
+	return (uint32_t)(m_sections.size() - 1);
+}
+
+void Profiler::record(uint32_t section, Clock::time_point start, Clock::time_point end)
+{
+	int64_t startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start - m_epoch).count();
+	int64_t durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	uint32_t thread = threadNumber();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Section& s = m_sections[section];
+	s.samples[s.next] = (float)(durationNs / 1e6);
+	s.next = (s.next + 1) % SAMPLES;
+	s.count = std::min(s.count + 1, SAMPLES);
+	s.total += durationNs / 1e6;
+	s.calls++;
+
+	m_events[m_nextEvent] = { section, thread, startNs, durationNs };
+	m_nextEvent = (m_nextEvent + 1) % EVENTS;
+	m_eventCount = std::min(m_eventCount + 1, EVENTS);
+}
+
+std::vector<Profiler::Stats> Profiler::stats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::vector<Stats> result;
+	for (const Section& s : m_sections)
+	{
+		Stats stats;
+		stats.name = s.name;
+		if (s.count > 0)
+		{
+			m_scratch.assign(s.samples.begin(), s.samples.begin() + s.count);
+			size_t p50 = m_scratch.size() / 2;
+			size_t p99 = (m_scratch.size() * 99) / 100;
+			std::nth_element(m_scratch.begin(), m_scratch.begin() + p50, m_scratch.end());
+			stats.p50 = m_scratch[p50];
+			std::nth_element(m_scratch.begin(), m_scratch.begin() + p99, m_scratch.end());
+			stats.p99 = m_scratch[p99];
+			stats.last = s.samples[(s.next + SAMPLES - 1) % SAMPLES];
+		}
+		stats.total = s.total;
+		stats.calls = s.calls;
+		result.push_back(stats);
+	}
+	return result;
+}
+
+void Profiler::resetTotals()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (Section& s : m_sections)
+	{
+		s.total = 0;
+		s.calls = 0;
+	}
+}
+
+bool Profiler::exportTrace(const std::string& path) const
+{
+	std::ofstream fout(path);
+	if (!fout)
+	{
+		std::cerr << "Could not write the trace to " << path << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Complete ("X") events, timestamps in microseconds. Oldest first.
+	fout.setf(std::ios::fixed);
+	fout.precision(3);
+	fout << "{\"traceEvents\":[\n";
+	size_t first = (m_nextEvent + EVENTS - m_eventCount) % EVENTS;
+	for (size_t i = 0; i < m_eventCount; i++)
+	{
+		const Event& e = m_events[(first + i) % EVENTS];
+		fout << "{\"name\":\"" << m_sections[e.section].name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread << ",\"ts\":"
+			<< e.start / 1000.0 << ",\"dur\":" << e.duration / 1000.0 << "}" << (i + 1 < m_eventCount ? ",\n" : "\n");
+	}
+	fout << "],\"displayTimeUnit\":\"ms\"}\n";
+
+	std::cout << "Wrote " << m_eventCount << " trace events to " << path << std::endl;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Times named sections of the frame (usually one per system). Each section keeps its
+// last SAMPLES durations for percentiles, and every timed scope is also logged to a
+// ring of recent events that can be exported in Chrome's trace event format.
+// Scopes may be timed from the scheduler's worker threads, so recording takes a lock.
+class Profiler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+	static constexpr size_t SAMPLES = 240;
+	static constexpr size_t EVENTS = 1 << 16;
+
+	struct Stats
+	{
+		std::string name;
+		double p50 = 0; // milliseconds
+		double p99 = 0;
+		double last = 0;
+		double total = 0;   // milliseconds, since the last resetTotals
+		uint64_t calls = 0; // also since the last resetTotals
+	};
+
+private:
+	struct Section
+	{
+		const char* name;
+		std::vector<float> samples; // milliseconds, used as a ring
+		size_t next = 0;
+		size_t count = 0;
+		double total = 0;
+		uint64_t calls = 0;
+	};
+
+	struct Event
+	{
+		uint32_t section;
+		uint32_t thread; // small per thread number, 1 is the first thread that recorded anything
+		int64_t start; // nanoseconds since m_epoch
+		int64_t duration;
+	};
+
+	std::vector<Section> m_sections;
+	std::vector<Event> m_events; // ring of the last EVENTS scopes
+	size_t m_nextEvent = 0;
+	size_t m_eventCount = 0;
+	Clock::time_point m_epoch = Clock::now();
+	std::vector<float> m_scratch;
+	mutable std::mutex m_mutex;
+
+	uint32_t sectionIndex(const char* name);
+
+public:
+	// Times the rest of the enclosing block under the given section name
+	class Scope
+	{
+		Profiler& m_profiler;
+		uint32_t m_section;
+		Clock::time_point m_start;
+
+	public:
+		Scope(Profiler& profiler, const char* name);
+		~Scope();
+	};
+
+	Profiler();
+
+	void record(uint32_t section, Clock::time_point start, Clock::time_point end);
+
+	// p50/p99 of the recent samples of every section, in the order they were first timed
+	std::vector<Stats> stats();
+
+	// Start every section's running total over, to time a stretch longer than SAMPLES
+	void resetTotals();
+
+	// Writes the buffered events as Chrome trace event JSON (chrome://tracing, Perfetto)
+	bool exportTrace(const std::string& path) const;
+};
\ No newline at end of file
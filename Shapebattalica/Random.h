@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+// PCG32 (pcg-random.org): small, fast, and the same sequence for the same seed on every
+// platform, unlike rand(). Everything random in the simulation has to come from here
+// for recorded runs to replay identically.
+class Random
+{
+	uint64_t m_state = 0;
+	uint64_t m_inc = 1;
+
+public:
+	Random(uint64_t seed = 0x853c49e6748fea9bULL) { setSeed(seed); }
+
+	void setSeed(uint64_t seed)
+	{
+		m_state = 0;
+		m_inc = (0xda3e39cb94b95bdbULL << 1u) | 1u;
+		next();
+		m_state += seed;
+		next();
+	}
+
+	// The whole generator state, to carry a sequence on across a save and load. The stream
+	// increment isn't included, setSeed always uses the same one.
+	uint64_t state() const { return m_state; }
+	void setState(uint64_t state) { m_state = state; }
+
+	uint32_t next()
+	{
+		uint64_t old = m_state;
+		m_state = old * 6364136223846793005ULL + m_inc;
+		uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+		uint32_t rot = (uint32_t)(old >> 59u);
+		return (xorshifted >> rot) | (xorshifted << ((0u - rot) & 31u));
+	}
+
+	// Uniform integer in [min, max], without the modulo bias of rand() % n
+	int range(int min, int max)
+	{
+		uint32_t span = (uint32_t)(max - min) + 1u;
+		if (span == 0)
+		{
+			return (int)next();
+		}
+		uint64_t m = (uint64_t)next() * span;
+		uint32_t low = (uint32_t)m;
+		if (low < span)
+		{
+			uint32_t threshold = (0u - span) % span;
+			while (low < threshold)
+			{
+				m = (uint64_t)next() * span;
+				low = (uint32_t)m;
+			}
+		}
+		return min + (int)(m >> 32);
+	}
+};
\ No newline at end of file
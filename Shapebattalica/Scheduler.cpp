@@ -0,0 +1,123 @@
+#include "Scheduler.h"
+#include <algorithm>
+
+// Set while a thread is running part of a job. Jobs don't nest, so a parallelFor inside
+// a chunk of another parallelFor just runs inline.
+static thread_local bool t_inJob = false;
+
+Scheduler::Scheduler(size_t threads)
+{
+	setThreads(threads);
+}
+
+Scheduler::~Scheduler()
+{
+	setThreads(1);
+}
+
+void Scheduler::setThreads(size_t threads)
+{
+	if (threads == 0)
+	{
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// Stop the old workers before starting the new ones
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+	m_quit = false;
+
+	for (size_t i = 1; i < threads; i++)
+	{
+		m_workers.emplace_back(&Scheduler::workerLoop, this);
+	}
+}
+
+size_t Scheduler::chunkCount(size_t count, size_t minChunk) const
+{
+	if (m_workers.empty() || t_inJob || count == 0)
+	{
+		return 1;
+	}
+
+	// A few chunks per thread so an unlucky slow chunk doesn't hold everyone up
+	size_t chunks = std::min(threads() * 4, count / std::max<size_t>(minChunk, 1));
+	return std::max<size_t>(chunks, 1);
+}
+
+void Scheduler::runChunks(ChunkFn fn, void* context, size_t count, size_t chunks)
+{
+	t_inJob = true;
+	for (size_t c = m_nextChunk++; c < chunks; c = m_nextChunk++)
+	{
+		fn(context, c * count / chunks, (c + 1) * count / chunks);
+		if (--m_chunksLeft == 0)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_done.notify_all();
+		}
+	}
+	t_inJob = false;
+}
+
+void Scheduler::dispatch(ChunkFn fn, void* context, size_t count, size_t chunks)
+{
+	{
+		// A worker that woke up late for the previous job may still be leaving it, wait for
+		// it so it can't claim a chunk of this job with the old function
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this]() { return m_busyWorkers == 0; });
+		m_fn = fn;
+		m_context = context;
+		m_count = count;
+		m_chunks = chunks;
+		m_nextChunk = 0;
+		m_chunksLeft = chunks;
+		m_job++;
+	}
+	m_wake.notify_all();
+
+	// The calling thread works too, then waits for the stragglers
+	runChunks(fn, context, count, chunks);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this]() { return m_chunksLeft == 0; });
+}
+
+void Scheduler::workerLoop()
+{
+	uint64_t lastJob = 0;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_wake.wait(lock, [&]() { return m_quit || m_job != lastJob; });
+		if (m_quit)
+		{
+			return;
+		}
+
+		lastJob = m_job;
+		ChunkFn fn = m_fn;
+		void* context = m_context;
+		size_t count = m_count;
+		size_t chunks = m_chunks;
+		m_busyWorkers++;
+		lock.unlock();
+
+		runChunks(fn, context, count, chunks);
+
+		lock.lock();
+		if (--m_busyWorkers == 0)
+		{
+			m_done.notify_all();
+		}
+	}
+}
\ No newline at end of file
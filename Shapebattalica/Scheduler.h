@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// A small pool of worker threads for the simulation's big loops.
+//
+// The systems themselves run one after another on the calling thread, each reads what the one
+// before it wrote, so they can't overlap without the simulation going nondeterministic.
+// Inside a system, parallelFor splits a row range into chunks across the pool.
+// Small ranges run inline, so a normal sized game never pays for the threads.
+class Scheduler
+{
+	typedef void (*ChunkFn)(void* context, size_t begin, size_t end);
+
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	bool m_quit = false;
+
+	// The job being worked on, only changed while no worker is inside it
+	uint64_t m_job = 0;
+	ChunkFn m_fn = nullptr;
+	void* m_context = nullptr;
+	size_t m_count = 0;
+	size_t m_chunks = 0;
+	std::atomic<size_t> m_nextChunk{ 0 };
+	std::atomic<size_t> m_chunksLeft{ 0 };
+	size_t m_busyWorkers = 0;
+
+	void workerLoop();
+	void runChunks(ChunkFn fn, void* context, size_t count, size_t chunks);
+	void dispatch(ChunkFn fn, void* context, size_t count, size_t chunks);
+	size_t chunkCount(size_t count, size_t minChunk) const;
+
+public:
+	// threads is the total including the calling thread, 0 uses one per core
+	Scheduler(size_t threads = 1);
+	~Scheduler();
+
+	Scheduler(const Scheduler&) = delete;
+	Scheduler& operator = (const Scheduler&) = delete;
+
+	void setThreads(size_t threads);
+	size_t threads() const { return m_workers.size() + 1; }
+
+	// Calls fn(begin, end) over [0, count) in chunks of at least minChunk, spread over the pool.
+	// Chunks must only touch their own rows. Returns once every chunk has finished.
+	template <typename F>
+	void parallelFor(size_t count, size_t minChunk, F&& fn)
+	{
+		size_t chunks = chunkCount(count, minChunk);
+		if (chunks <= 1)
+		{
+			fn((size_t)0, count);
+			return;
+		}
+
+		typedef std::remove_reference_t<F> Fn;
+		dispatch([](void* context, size_t begin, size_t end) { (*static_cast<Fn*>(context))(begin, end); },
+			(void*)&fn, count, chunks);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "ShapeBatch.h"
+#include <math.h>
+
+ShapeBatch::ShapeBatch()
+	: m_vertices(sf::Triangles) {}
+
+void ShapeBatch::clear()
+{
+	m_vertices.clear();
+}
+
+void ShapeBatch::reserve(size_t shapes, size_t maxPoints)
+{
+	// Every point adds one fill triangle and an outline quad of two triangles.
+	// VertexArray has no reserve, but clearing keeps the capacity of the resize
+	m_vertices.resize(shapes * maxPoints * 9);
+	m_vertices.clear();
+}
+
+void ShapeBatch::add(float x, float y, float rotation, float scale, const ShapeGeometry& geometry,
+	const sf::Color& fill, const sf::Color& outline)
+{
+	const size_t points = geometry.points;
+	if (points < 3)
+	{
+		return;
+	}
+
+	// Rotate and scale the cached corners once per shape instead of building an sf::Transform
+	float a = rotation * 3.141592654f / 180.0f;
+	float c = cosf(a) * scale, s = sinf(a) * scale;
+	sf::Vector2f center(x, y);
+
+	auto place = [&](const sf::Vector2f& p)
+	{
+		return sf::Vector2f(x + p.x * c - p.y * s, y + p.x * s + p.y * c);
+	};
+
+	for (size_t i = 0; i < points; i++)
+	{
+		const size_t next = (i + 1) % points;
+		sf::Vector2f in0 = place(geometry.inner[i]), in1 = place(geometry.inner[next]);
+
+		// Fill is a fan of triangles around the centre
+		m_vertices.append(sf::Vertex(center, fill));
+		m_vertices.append(sf::Vertex(in0, fill));
+		m_vertices.append(sf::Vertex(in1, fill));
+
+		// Outline is a quad per edge, split into two triangles
+		if (geometry.outlineThickness != 0)
+		{
+			sf::Vector2f out0 = place(geometry.outer[i]), out1 = place(geometry.outer[next]);
+			m_vertices.append(sf::Vertex(in0, outline));
+			m_vertices.append(sf::Vertex(out0, outline));
+			m_vertices.append(sf::Vertex(out1, outline));
+			m_vertices.append(sf::Vertex(in0, outline));
+			m_vertices.append(sf::Vertex(out1, outline));
+			m_vertices.append(sf::Vertex(in1, outline));
+		}
+	}
+}
+
+void ShapeBatch::addQuad(float x, float y, float halfSize, const sf::Color& color)
+{
+	const sf::Vector2f topLeft(x - halfSize, y - halfSize), topRight(x + halfSize, y - halfSize);
+	const sf::Vector2f bottomLeft(x - halfSize, y + halfSize), bottomRight(x + halfSize, y + halfSize);
+	m_vertices.append(sf::Vertex(topLeft, color));
+	m_vertices.append(sf::Vertex(topRight, color));
+	m_vertices.append(sf::Vertex(bottomRight, color));
+	m_vertices.append(sf::Vertex(topLeft, color));
+	m_vertices.append(sf::Vertex(bottomRight, color));
+	m_vertices.append(sf::Vertex(bottomLeft, color));
+}
+
+void ShapeBatch::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+	target.draw(m_vertices, states);
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ShapeCache.h"
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+// Collects every polygon drawn in a frame into one triangle list, so the whole
+// scene is a single draw call no matter how many entities there are.
+// Shapes are laid out the same way sf::CircleShape lays them out, centred on their position.
+class ShapeBatch : public sf::Drawable
+{
+	sf::VertexArray m_vertices;
+
+	void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+public:
+	ShapeBatch();
+
+	// Empty the batch, keeping its storage for the next frame
+	void clear();
+
+	// Make room for this many shapes of up to maxPoints points, so filling the batch doesn't allocate
+	void reserve(size_t shapes, size_t maxPoints);
+
+	// Append a cached polygon's fill and outline, rotation is in degrees
+	void add(float x, float y, float rotation, float scale, const ShapeGeometry& geometry,
+		const sf::Color& fill, const sf::Color& outline);
+
+	// Append a plain square, two triangles, for shapes too small on screen for their corners to show
+	void addQuad(float x, float y, float halfSize, const sf::Color& color);
+
+	size_t vertexCount() const { return m_vertices.getVertexCount(); }
+};
\ No newline at end of file
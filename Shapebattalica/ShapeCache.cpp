@@ -0,0 +1,40 @@
+#include "ShapeCache.h"
+#include <algorithm>
+#include <math.h>
+
+ShapeCache::Id ShapeCache::intern(size_t points, float radius, float outlineThickness)
+{
+	// So few entries that a scan beats hashing
+	for (size_t id = 0; id < m_geometries.size(); id++)
+	{
+		const ShapeGeometry& g = m_geometries[id];
+		if (g.points == points && g.radius == radius && g.outlineThickness == outlineThickness)
+		{
+			return (Id)id;
+		}
+	}
+
+	ShapeGeometry g;
+	g.points = (uint32_t)points;
+	g.radius = radius;
+	g.outlineThickness = outlineThickness;
+	g.extent = radius;
+	if (points >= 3)
+	{
+		// Same point placement as sf::CircleShape. The outline corners sit
+		// thickness / cos(half the corner angle) further out than the polygon's.
+		float outer = radius + outlineThickness / cosf(3.141592654f / points);
+		g.extent = std::max(radius, outer);
+		for (size_t i = 0; i < points; i++)
+		{
+			float angle = i * 2 * 3.141592654f / points - 3.141592654f / 2;
+			sf::Vector2f unit(cosf(angle), sinf(angle));
+			g.inner.push_back(unit * radius);
+			g.outer.push_back(unit * outer);
+		}
+	}
+
+	m_maxExtent = std::max(m_maxExtent, g.extent);
+	m_geometries.push_back(std::move(g));
+	return (Id)(m_geometries.size() - 1);
+}
\ No newline at end of file
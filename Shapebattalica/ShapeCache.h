@@ -0,0 +1,42 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+
+// Geometry shared by every shape with the same point count, radius and outline thickness.
+// The corners are already scaled by the radius, so drawing one only rotates and moves them.
+struct ShapeGeometry
+{
+	uint32_t points = 0;
+	float radius = 0;
+	float outlineThickness = 0;
+	float extent = 0; // how far the outline reaches from the centre, for culling
+	std::vector<sf::Vector2f> inner; // polygon corners, the first straight up like sf::CircleShape
+	std::vector<sf::Vector2f> outer; // outline corners, mitred so the edges are outlineThickness wide
+};
+
+// Flyweight store for shape geometry. A game only ever has a couple of dozen distinct shapes
+// (one per enemy vertex count, their fragments, the player and bullets), so each entity keeps
+// a small id into here instead of its own sf::CircleShape and vertex arrays.
+//
+// Only interned from the serial spawning code, so the systems running in parallel can read it freely.
+class ShapeCache
+{
+	std::vector<ShapeGeometry> m_geometries;
+	float m_maxExtent = 0;
+
+public:
+	using Id = uint16_t;
+
+	// The id for this geometry, built the first time it's asked for
+	Id intern(size_t points, float radius, float outlineThickness);
+
+	// The reference is only good until the next intern
+	const ShapeGeometry& get(Id id) const { return m_geometries[id]; }
+
+	size_t size() const { return m_geometries.size(); }
+
+	// The furthest any shape reaches from its centre at scale 1
+	float maxExtent() const { return m_maxExtent; }
+};
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "Simd.h"
+
+#ifdef SIMD_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static bool cpuHasSSE2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] & (1 << 26)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool cpuHasAVX2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+
+	// The OS has to save the YMM registers too, or AVX instructions fault
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+bool Simd::supported(Path path)
+{
+#ifdef SIMD_X86
+	static const bool sse2 = cpuHasSSE2();
+	static const bool avx2 = cpuHasAVX2();
+#else
+	static const bool sse2 = false;
+	static const bool avx2 = false;
+#endif
+
+	switch (path)
+	{
+	case Path::Scalar: return true;
+	case Path::SSE: return sse2;
+	case Path::AVX2: return avx2;
+	default: return false;
+	}
+}
+
+Simd::Path Simd::best()
+{
+	static const Path path = supported(Path::AVX2) ? Path::AVX2 : supported(Path::SSE) ? Path::SSE : Path::Scalar;
+	return path;
+}
+
+const char* Simd::name(Path path)
+{
+	switch (path)
+	{
+	case Path::Scalar: return "Scalar";
+	case Path::SSE: return "SSE";
+	case Path::AVX2: return "AVX2";
+	default: return "Unknown";
+	}
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+// Kernels that have SIMD versions pick one at runtime from what the CPU supports,
+// so one build runs everywhere and still uses the wide registers where they exist.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+// MSVC lets any function use any intrinsic, the CPU check decides what actually runs
+#define SIMD_TARGET_SSE
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_SSE __attribute__((target("sse2")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+class Simd
+{
+public:
+	enum class Path { Scalar, SSE, AVX2, Count };
+
+	static bool supported(Path path);
+
+	// The widest path this CPU supports, worked out the first time it's asked for
+	static Path best();
+
+	static const char* name(Path path);
+};
\ No newline at end of file
@@ -0,0 +1,507 @@
+#include "Snapshot.h"
+#include "Game.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+	const char MAGIC[4] = { 'S', 'B', 'S', 'N' };
+
+	class Writer
+	{
+	public:
+		std::vector<uint8_t> data;
+
+		template <typename T>
+		void put(const T& value) { putArray(&value, 1); }
+
+		template <typename T>
+		void putArray(const T* values, size_t count)
+		{
+			// An empty vector's data() may be null, which insert mustn't be handed
+			if (count == 0)
+			{
+				return;
+			}
+			const uint8_t* bytes = (const uint8_t*)values;
+			data.insert(data.end(), bytes, bytes + count * sizeof(T));
+		}
+	};
+
+	// Reads from the loaded file, failing instead of running off the end of a truncated one
+	class Reader
+	{
+		const std::vector<uint8_t>& m_data;
+		size_t m_cursor = 0;
+
+	public:
+		Reader(const std::vector<uint8_t>& data)
+			: m_data(data) {}
+
+		template <typename T>
+		bool get(T& value) { return getArray(&value, 1); }
+
+		template <typename T>
+		bool getArray(T* values, size_t count)
+		{
+			size_t size = count * sizeof(T);
+			if (m_data.size() - m_cursor < size)
+			{
+				return false;
+			}
+			if (size == 0)
+			{
+				// Nothing to copy, and an empty vector's data() may be null
+				return true;
+			}
+			std::memcpy(values, &m_data[m_cursor], size);
+			m_cursor += size;
+			return true;
+		}
+	};
+
+	uint8_t packInput(const CInput& input)
+	{
+		return (input.up ? 1 : 0) | (input.left ? 2 : 0) | (input.down ? 4 : 0) | (input.right ? 8 : 0) | (input.shoot ? 16 : 0);
+	}
+
+	CInput unpackInput(uint8_t state)
+	{
+		CInput input;
+		input.up = (state & 1) != 0;
+		input.left = (state & 2) != 0;
+		input.down = (state & 4) != 0;
+		input.right = (state & 8) != 0;
+		input.shoot = (state & 16) != 0;
+		return input;
+	}
+
+	void putColor(Writer& out, const sf::Color& color)
+	{
+		uint8_t rgba[4] = { color.r, color.g, color.b, color.a };
+		out.putArray(rgba, 4);
+	}
+
+	bool getColor(Reader& in, sf::Color& color)
+	{
+		uint8_t rgba[4];
+		if (!in.getArray(rgba, 4))
+		{
+			return false;
+		}
+		color = sf::Color(rgba[0], rgba[1], rgba[2], rgba[3]);
+		return true;
+	}
+
+	// Puts each tag's bucket back in its saved order, given as rows
+	void setBucketOrders(EntityManager& entities, const std::vector<std::vector<uint32_t>>& buckets, const std::vector<Entity>& loaded)
+	{
+		EntityVec order;
+		for (size_t t = 0; t < (size_t)Tag::Count; t++)
+		{
+			order.clear();
+			for (uint32_t row : buckets[t])
+			{
+				order.push_back(loaded[row]);
+			}
+			entities.setBucketOrder((Tag)t, order);
+		}
+	}
+}
+
+bool Snapshot::save(Game& game, const std::string& path)
+{
+	// Store the rows exactly as they are, without updating first: entities spawned this tick
+	// are still waiting to be added, and dead ones are still waiting to be removed. The loaded
+	// game's next update then does what this one's does, and saving changes nothing here.
+	EntityManager& entities = game.m_entities;
+	const uint32_t count = (uint32_t)entities.rowCount();
+	const uint32_t liveCount = (uint32_t)entities.size();
+	TransformPool& tf = entities.transforms();
+
+	// A dead row only has to hold its place until it's removed, so its components are left out
+	std::vector<uint8_t> masks(count);
+	std::vector<uint32_t> dead;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		masks[i] = entities.isActive((size_t)i) ? entities.mask(i) : 0;
+		if (!entities.isActive((size_t)i))
+		{
+			dead.push_back(i);
+		}
+	}
+
+	Writer out;
+	out.data.reserve(64 + (size_t)count * 96);
+	out.putArray(MAGIC, 4);
+	out.put(VERSION);
+	out.put(count);
+	out.put(liveCount);
+	out.put((uint32_t)entities.row(game.m_player));
+	out.put(game.m_score);
+	out.put(game.m_currentFrame);
+	out.put(game.m_lastEnemySpawnTime);
+	out.put(game.m_lastSpecialShot);
+	out.put(game.m_rng.state());
+	out.put(game.m_arenaSize.x);
+	out.put(game.m_arenaSize.y);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		out.put((uint8_t)entities.tag((size_t)i));
+	}
+	out.putArray(masks.data(), count);
+	out.put((uint32_t)dead.size());
+	out.putArray(dead.data(), dead.size());
+
+	// Removal reorders the tag buckets independently of the rows, so each bucket is stored as rows.
+	// Only added entities are in a bucket, waiting ones join theirs in row order.
+	for (size_t t = 0; t < (size_t)Tag::Count; t++)
+	{
+		const RowVec& bucket = entities.rows((Tag)t);
+		out.put((uint32_t)bucket.size());
+		out.putArray(bucket.data(), bucket.size());
+	}
+
+	// Every row has a transform
+	out.putArray(tf.posX.data(), count);
+	out.putArray(tf.posY.data(), count);
+	out.putArray(tf.velX.data(), count);
+	out.putArray(tf.velY.data(), count);
+	out.putArray(tf.angle.data(), count);
+	out.putArray(tf.bounceRadius.data(), count);
+	out.putArray(tf.prevX.data(), count);
+	out.putArray(tf.prevY.data(), count);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (masks[i] & componentBit<CShape>)
+		{
+			// The geometry is stored by value, ids are only meaningful to this run's ShapeCache
+			const CShape& shape = entities.get<CShape>(i);
+			const ShapeGeometry& geometry = game.m_shapes.get(shape.geometry);
+			out.put(geometry.points);
+			out.put(geometry.radius);
+			out.put(geometry.outlineThickness);
+			out.put(shape.scale);
+			putColor(out, shape.fill);
+			putColor(out, shape.outline);
+		}
+	}
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (masks[i] & componentBit<CCollision>)
+		{
+			out.put(entities.get<CCollision>(i).radius);
+		}
+	}
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (masks[i] & componentBit<CInput>)
+		{
+			out.put(packInput(entities.get<CInput>(i)));
+		}
+	}
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (masks[i] & componentBit<CScore>)
+		{
+			out.put(entities.get<CScore>(i).score);
+		}
+	}
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (masks[i] & componentBit<CLifespan>)
+		{
+			out.put(entities.get<CLifespan>(i).remaining(game.m_currentFrame));
+			out.put(entities.get<CLifespan>(i).total);
+		}
+	}
+
+	std::ofstream fout(path, std::ios::binary);
+	fout.write((const char*)out.data.data(), out.data.size());
+	if (!fout)
+	{
+		std::cerr << "Could not write the snapshot to " << path << std::endl;
+		return false;
+	}
+
+	std::cout << "Saved " << count << " entities at tick " << game.m_currentFrame << " to " << path << std::endl;
+	return true;
+}
+
+bool Snapshot::load(Game& game, const std::string& path)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::ifstream fin(path, std::ios::binary | std::ios::ate);
+	if (!fin)
+	{
+		std::cerr << "Could not open the snapshot " << path << std::endl;
+		return false;
+	}
+	std::vector<uint8_t> data((size_t)fin.tellg());
+	fin.seekg(0);
+	fin.read((char*)data.data(), data.size());
+
+	Reader in(data);
+	char magic[4] = {};
+	uint32_t version = 0, count = 0, liveCount = 0, playerRow = 0;
+	int score = 0, currentFrame = 0, lastEnemySpawnTime = 0, lastSpecialShot = 0;
+	uint64_t rngState = 0;
+	Vec2 arenaSize;
+	if (!in.getArray(magic, 4) || std::memcmp(magic, MAGIC, 4) != 0 || !in.get(version))
+	{
+		std::cerr << path << " is not a snapshot" << std::endl;
+		return false;
+	}
+	if (version != VERSION)
+	{
+		std::cerr << path << " is snapshot version " << version << ", expected " << VERSION << std::endl;
+		return false;
+	}
+	if (!in.get(count) || !in.get(liveCount) || !in.get(playerRow) || !in.get(score) || !in.get(currentFrame) || !in.get(lastEnemySpawnTime) ||
+		!in.get(lastSpecialShot) || !in.get(rngState) || !in.get(arenaSize.x) || !in.get(arenaSize.y) || liveCount > count || playerRow >= count)
+	{
+		std::cerr << path << " has a broken header" << std::endl;
+		return false;
+	}
+
+	std::vector<uint8_t> tags(count), masks(count);
+	uint32_t deadCount = 0;
+	if (!in.getArray(tags.data(), count) || !in.getArray(masks.data(), count) || !in.get(deadCount) || deadCount > count)
+	{
+		std::cerr << path << " is truncated" << std::endl;
+		return false;
+	}
+	std::vector<uint32_t> dead(deadCount);
+	std::vector<uint8_t> isDead(count, 0);
+	if (!in.getArray(dead.data(), deadCount))
+	{
+		std::cerr << path << " is truncated" << std::endl;
+		return false;
+	}
+	for (uint32_t row : dead)
+	{
+		if (row >= count || isDead[row])
+		{
+			std::cerr << path << " has broken dead rows" << std::endl;
+			return false;
+		}
+		isDead[row] = 1;
+	}
+	for (uint8_t tag : tags)
+	{
+		if (tag >= (uint8_t)Tag::Count)
+		{
+			std::cerr << path << " has an entity with an unknown tag" << std::endl;
+			return false;
+		}
+	}
+	if (tags[playerRow] != (uint8_t)Tag::Player || isDead[playerRow])
+	{
+		std::cerr << path << " doesn't have a player" << std::endl;
+		return false;
+	}
+
+	// Every added row has to be in its own tag's bucket exactly once
+	std::vector<std::vector<uint32_t>> buckets((size_t)Tag::Count);
+	std::vector<uint8_t> bucketed(liveCount, 0);
+	for (size_t t = 0; t < (size_t)Tag::Count; t++)
+	{
+		uint32_t size = 0;
+		if (!in.get(size) || size > liveCount)
+		{
+			std::cerr << path << " has broken tag buckets" << std::endl;
+			return false;
+		}
+		buckets[t].resize(size);
+		if (!in.getArray(buckets[t].data(), size))
+		{
+			std::cerr << path << " is truncated" << std::endl;
+			return false;
+		}
+		for (uint32_t row : buckets[t])
+		{
+			if (row >= liveCount || tags[row] != t || bucketed[row])
+			{
+				std::cerr << path << " has broken tag buckets" << std::endl;
+				return false;
+			}
+			bucketed[row] = 1;
+		}
+	}
+	if (std::find(bucketed.begin(), bucketed.end(), 0) != bucketed.end())
+	{
+		std::cerr << path << " has broken tag buckets" << std::endl;
+		return false;
+	}
+
+	// Read every component into temporaries first, so a truncated file fails before the world is touched
+	TransformPool transforms;
+	transforms.resize(count);
+	bool ok = in.getArray(transforms.posX.data(), count) && in.getArray(transforms.posY.data(), count) &&
+		in.getArray(transforms.velX.data(), count) && in.getArray(transforms.velY.data(), count) &&
+		in.getArray(transforms.angle.data(), count) && in.getArray(transforms.bounceRadius.data(), count) &&
+		in.getArray(transforms.prevX.data(), count) && in.getArray(transforms.prevY.data(), count);
+
+	struct SavedShape
+	{
+		uint32_t points = 0;
+		float radius = 0, thickness = 0, scale = 1;
+		sf::Color fill, outline;
+	};
+	std::vector<SavedShape> shapes;
+	std::vector<CCollision> collisions;
+	std::vector<CInput> inputs;
+	std::vector<CScore> scores;
+	std::vector<CLifespan> lifespans;
+	for (uint32_t i = 0; ok && i < count; i++)
+	{
+		if (masks[i] & componentBit<CShape>)
+		{
+			SavedShape shape;
+			ok = in.get(shape.points) && in.get(shape.radius) && in.get(shape.thickness) && in.get(shape.scale) &&
+				getColor(in, shape.fill) && getColor(in, shape.outline) && shape.points <= 64;
+			shapes.push_back(shape);
+		}
+	}
+	for (uint32_t i = 0; ok && i < count; i++)
+	{
+		if (masks[i] & componentBit<CCollision>)
+		{
+			collisions.emplace_back();
+			ok = in.get(collisions.back().radius);
+		}
+	}
+	for (uint32_t i = 0; ok && i < count; i++)
+	{
+		uint8_t state = 0;
+		if (masks[i] & componentBit<CInput>)
+		{
+			ok = in.get(state);
+			inputs.push_back(unpackInput(state));
+		}
+	}
+	for (uint32_t i = 0; ok && i < count; i++)
+	{
+		if (masks[i] & componentBit<CScore>)
+		{
+			scores.emplace_back();
+			ok = in.get(scores.back().score);
+		}
+	}
+	for (uint32_t i = 0; ok && i < count; i++)
+	{
+		if (masks[i] & componentBit<CLifespan>)
+		{
+			CLifespan lifespan;
+			int remaining = 0;
+			ok = in.get(remaining) && in.get(lifespan.total);
+			lifespan.expires = currentFrame + remaining;
+			lifespans.push_back(lifespan);
+		}
+	}
+
+	if (!ok)
+	{
+		std::cerr << path << " is truncated" << std::endl;
+		return false;
+	}
+
+	// Recreate the entities in their saved order, so every row and tag bucket lines up with
+	// the saved game's. The added ones go in first and the waiting ones after the update,
+	// so they're still waiting. They get fresh handles, any held from before the load are stale.
+	EntityManager& entities = game.m_entities;
+	entities.clear();
+	entities.reserve(count);
+	std::vector<Entity> loaded(count);
+	auto add = [&](uint32_t i)
+	{
+		loaded[i] = entities.addEntity((Tag)tags[i]);
+		entities.addComponent(loaded[i], CTransform(Vec2(), Vec2(), 0.0f));
+	};
+	for (uint32_t i = 0; i < liveCount; i++)
+	{
+		add(i);
+	}
+	entities.update();
+	setBucketOrders(entities, buckets, loaded);
+	for (uint32_t i = liveCount; i < count; i++)
+	{
+		add(i);
+	}
+
+	// New entities' rows start at 0, so the transform arrays copy straight into place
+	TransformPool& tf = entities.transforms();
+	std::copy_n(transforms.posX.begin(), count, tf.posX.begin());
+	std::copy_n(transforms.posY.begin(), count, tf.posY.begin());
+	std::copy_n(transforms.velX.begin(), count, tf.velX.begin());
+	std::copy_n(transforms.velY.begin(), count, tf.velY.begin());
+	std::copy_n(transforms.angle.begin(), count, tf.angle.begin());
+	std::copy_n(transforms.bounceRadius.begin(), count, tf.bounceRadius.begin());
+	std::copy_n(transforms.prevX.begin(), count, tf.prevX.begin());
+	std::copy_n(transforms.prevY.begin(), count, tf.prevY.begin());
+
+	// Each component's temporaries are in row order, for the rows that have it
+	size_t shapeIndex = 0, collisionIndex = 0, inputIndex = 0, scoreIndex = 0, lifespanIndex = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (masks[i] & componentBit<CShape>)
+		{
+			const SavedShape& saved = shapes[shapeIndex++];
+			CShape& shape = entities.addComponent<CShape>(loaded[i]);
+			shape.set(game.m_shapes.intern(saved.points, saved.radius, saved.thickness), saved.fill, saved.outline);
+			shape.scale = saved.scale;
+		}
+		if (masks[i] & componentBit<CCollision>)
+		{
+			entities.addComponent(loaded[i], collisions[collisionIndex++]);
+		}
+		if (masks[i] & componentBit<CInput>)
+		{
+			entities.addComponent(loaded[i], inputs[inputIndex++]);
+		}
+		if (masks[i] & componentBit<CScore>)
+		{
+			entities.addComponent(loaded[i], scores[scoreIndex++]);
+		}
+		if (masks[i] & componentBit<CLifespan>)
+		{
+			entities.addComponent(loaded[i], lifespans[lifespanIndex++]);
+		}
+	}
+
+	game.m_player = loaded[playerRow];
+	game.m_score = score;
+	game.m_currentFrame = currentFrame;
+	game.m_lastEnemySpawnTime = lastEnemySpawnTime;
+	game.m_lastSpecialShot = lastSpecialShot;
+	game.resetTimers();
+	game.m_enemyGridCurrent = false;
+
+	// resetTimers only sees added entities, the waiting ones' lifespans need their timers too
+	for (uint32_t i = liveCount; i < count; i++)
+	{
+		if (masks[i] & componentBit<CLifespan>)
+		{
+			game.m_timers.schedule(entities.get<CLifespan>(loaded[i]).expires, Timer::Lifespan, loaded[i]);
+		}
+	}
+
+	// Entities that died this tick go the next update, same as in the saved game
+	for (uint32_t row : dead)
+	{
+		entities.destroy(loaded[row]);
+	}
+	game.m_rng.setState(rngState);
+	game.m_arenaSize = arenaSize;
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Loaded " << count << " entities at tick " << currentFrame << " from " << path << " in " << ms << " ms" << std::endl;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class Game;
+
+// Saves and restores the whole simulation: every entity with its components, the
+// game's counters and the random generator, so a restored game carries on exactly as
+// the saved one would have. Used to warm start soak tests from a busy late game.
+// Entities spawned or killed since the last update are stored as they are, still
+// waiting to be added or removed, so saving leaves the world it saves alone.
+//
+// The file is written with one write and read back with one read. After the header,
+// each per-entity field is stored as a packed array in row order, and each component
+// only for the entities that have it. Numbers are stored in the machine's byte order,
+// same as the input logs.
+//
+// An input log recorded after loading a snapshot carries on from the snapshot's tick,
+// so replay it with the same snapshot loaded.
+class Snapshot
+{
+public:
+	static constexpr uint32_t VERSION = 5;
+
+	static bool save(Game& game, const std::string& path);
+
+	// Leaves the game as it was if the file is broken or truncated
+	static bool load(Game& game, const std::string& path);
+};
\ No newline at end of file
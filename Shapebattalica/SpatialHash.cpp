@@ -0,0 +1,57 @@
+#include "SpatialHash.h"
+#include <algorithm>
+
+SpatialHash::SpatialHash(float cellSize)
+{
+	setCellSize(cellSize);
+}
+
+void SpatialHash::setCellSize(float cellSize)
+{
+	m_cellSize = cellSize;
+	m_invCellSize = 1.0f / cellSize;
+}
+
+void SpatialHash::reserve(size_t count)
+{
+	// Worst case, the bucket table rounds up to four buckets per item and every item spans four cells
+	m_bucketStart.reserve(count * 4 + 1);
+	m_cursor.reserve(count * 4);
+	m_entries.reserve(count * 4);
+	m_stamps.reserve(count);
+}
+
+void SpatialHash::rebuild(const float* x, const float* y, const float* r, size_t count)
+{
+	// Keep roughly two buckets per item, as a power of two so hashing is a mask
+	size_t buckets = 64;
+	while (buckets < count * 2)
+	{
+		buckets *= 2;
+	}
+	m_bucketMask = (uint32_t)(buckets - 1);
+	m_bucketStart.assign(buckets + 1, 0);
+
+	// Counting sort: first count how many entries land in each bucket...
+	for (size_t i = 0; i < count; i++)
+	{
+		forEachBucket(x[i] - r[i], y[i] - r[i], x[i] + r[i], y[i] + r[i], [&](uint32_t b) { m_bucketStart[b + 1]++; });
+	}
+
+	// ...turn the counts into start offsets...
+	for (size_t b = 0; b < buckets; b++)
+	{
+		m_bucketStart[b + 1] += m_bucketStart[b];
+	}
+
+	// ...then drop every item into its buckets
+	m_entries.resize(m_bucketStart[buckets]);
+	m_cursor.assign(m_bucketStart.begin(), m_bucketStart.end() - 1);
+	for (size_t i = 0; i < count; i++)
+	{
+		forEachBucket(x[i] - r[i], y[i] - r[i], x[i] + r[i], y[i] + r[i], [&](uint32_t b) { m_entries[m_cursor[b]++] = (uint32_t)i; });
+	}
+
+	m_stamps.assign(count, 0);
+	m_queryStamp = 0;
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+
+// Uniform grid broadphase. Space is split into square cells of m_cellSize, and each
+// cell is hashed into a fixed size bucket table so the world doesn't need bounds.
+// Items are circles, inserted into every cell their bounding box touches.
+//
+// The table is rebuilt from scratch each tick with a counting sort, so after the
+// first few frames it doesn't allocate. Queries report each overlapping item once.
+class SpatialHash
+{
+	float m_cellSize = 64.0f;
+	float m_invCellSize = 1.0f / 64.0f;
+	uint32_t m_bucketMask = 0;
+
+	std::vector<uint32_t> m_bucketStart; // bucket b's items are m_entries[m_bucketStart[b] .. m_bucketStart[b + 1])
+	std::vector<uint32_t> m_entries;     // item indices, grouped by bucket
+	std::vector<uint32_t> m_cursor;      // per bucket fill position, only used while rebuilding
+	std::vector<uint32_t> m_stamps;      // last query that reported each item, for deduplication
+	uint32_t m_queryStamp = 0;
+
+	int cellCoord(float v) const { return (int)std::floor(v * m_invCellSize); }
+
+	uint32_t bucket(int cx, int cy) const
+	{
+		return (((uint32_t)cx * 73856093u) ^ ((uint32_t)cy * 19349663u)) & m_bucketMask;
+	}
+
+	template <typename F>
+	void forEachBucket(float left, float top, float right, float bottom, F&& fn) const
+	{
+		int minX = cellCoord(left), maxX = cellCoord(right);
+		int minY = cellCoord(top), maxY = cellCoord(bottom);
+		for (int cy = minY; cy <= maxY; cy++)
+		{
+			for (int cx = minX; cx <= maxX; cx++)
+			{
+				fn(bucket(cx, cy));
+			}
+		}
+	}
+
+public:
+	SpatialHash(float cellSize = 64.0f);
+
+	void setCellSize(float cellSize);
+
+	// Size the tables for up to count items up front, so rebuilding never allocates
+	void reserve(size_t count);
+	float cellSize() const { return m_cellSize; }
+
+	// Replace the contents with count circles, item i is at (x[i], y[i]) with radius r[i]
+	void rebuild(const float* x, const float* y, const float* r, size_t count);
+
+	// Calls fn(item) once for every item whose cells overlap the circle's bounding box.
+	// These are only candidates, the caller still does the exact overlap test.
+	template <typename F>
+	void query(float x, float y, float r, F&& fn)
+	{
+		queryRect(x - r, y - r, x + r, y + r, fn);
+	}
+
+	// How many cells a rectangle covers, which is what a query over it costs before any items
+	size_t cellCount(float left, float top, float right, float bottom) const
+	{
+		return (size_t)(cellCoord(right) - cellCoord(left) + 1) * (size_t)(cellCoord(bottom) - cellCoord(top) + 1);
+	}
+
+	// Same as query, for the items whose cells overlap a rectangle
+	template <typename F>
+	void queryRect(float left, float top, float right, float bottom, F&& fn)
+	{
+		if (m_entries.empty())
+		{
+			return;
+		}
+
+		if (++m_queryStamp == 0)
+		{
+			// The stamp wrapped around, clear out the old ones so nothing is skipped by mistake
+			std::fill(m_stamps.begin(), m_stamps.end(), 0);
+			m_queryStamp = 1;
+		}
+
+		forEachBucket(left, top, right, bottom, [&](uint32_t b)
+		{
+			for (uint32_t i = m_bucketStart[b]; i < m_bucketStart[b + 1]; i++)
+			{
+				uint32_t item = m_entries[i];
+				if (m_stamps[item] != m_queryStamp)
+				{
+					m_stamps[item] = m_queryStamp;
+					fn(item);
+				}
+			}
+		});
+	}
+};
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "TimerWheel.h"
+#include "Random.h"
+#include <iostream>
+
+TimerWheel::TimerWheel()
+{
+	reset(0);
+}
+
+void TimerWheel::file(uint32_t node, int now)
+{
+	// The timer belongs to the first level where due and now agree on every higher digit,
+	// anything due before the next digit turns over lands in that level's slot for its digit
+	const uint32_t due = (uint32_t)m_nodes[node].timer.due;
+	int level = 0;
+	while (level < LEVELS - 1 && (due >> (SLOT_BITS * (level + 1))) != ((uint32_t)now >> (SLOT_BITS * (level + 1))))
+	{
+		level++;
+	}
+	uint32_t& head = m_slots[level][(due >> (SLOT_BITS * level)) & SLOT_MASK];
+	m_nodes[node].next = head;
+	head = node;
+}
+
+void TimerWheel::reset(int now)
+{
+	for (auto& level : m_slots)
+	{
+		for (uint32_t& head : level)
+		{
+			head = NONE;
+		}
+	}
+	m_nodes.clear();
+	m_free = NONE;
+	m_now = now;
+	m_count = 0;
+}
+
+void TimerWheel::schedule(int due, Timer::Kind kind, Entity entity)
+{
+	uint32_t node = m_free;
+	if (node != NONE)
+	{
+		m_free = m_nodes[node].next;
+	}
+	else
+	{
+		node = (uint32_t)m_nodes.size();
+		m_nodes.emplace_back();
+	}
+
+	Timer& timer = m_nodes[node].timer;
+	timer.due = due > m_now ? due : m_now + 1;
+	timer.kind = kind;
+	timer.entity = entity;
+	file(node, m_now);
+	m_count++;
+}
+
+void TimerWheel::advance(int tick, std::vector<Timer>& fired)
+{
+	while (m_now < tick)
+	{
+		const int now = ++m_now;
+
+		// Whenever a level's digit turns over, the next slot up is now close enough to spread out
+		// over the levels below. Going from the top down, a timer can move down several levels.
+		for (int level = LEVELS - 1; level > 0; level--)
+		{
+			if (((uint32_t)now & ((1u << (SLOT_BITS * level)) - 1)) != 0)
+			{
+				continue;
+			}
+			uint32_t& head = m_slots[level][((uint32_t)now >> (SLOT_BITS * level)) & SLOT_MASK];
+			uint32_t node = head;
+			head = NONE;
+			while (node != NONE)
+			{
+				const uint32_t next = m_nodes[node].next;
+				file(node, now);
+				node = next;
+			}
+		}
+
+		uint32_t& head = m_slots[0][now & SLOT_MASK];
+		uint32_t node = head;
+		head = NONE;
+		while (node != NONE)
+		{
+			const uint32_t next = m_nodes[node].next;
+			fired.push_back(m_nodes[node].timer);
+			m_nodes[node].next = m_free;
+			m_free = node;
+			m_count--;
+			node = next;
+		}
+	}
+}
+
+void TimerWheel::test()
+{
+	// Random timers from a tick to a few hundred thousand ticks out, each has to go off exactly on its tick
+	TimerWheel wheel;
+	Random rng(1357);
+	const int start = 65000;
+	wheel.reset(start);
+	std::vector<int> expected(400000, 0);
+	for (int i = 0; i < 20000; i++)
+	{
+		const int due = start + 1 + (i % 4 == 0 ? rng.range(0, 300) : rng.range(0, 330000));
+		wheel.schedule(due, Timer::Lifespan);
+		expected[due - start]++;
+	}
+
+	int errors = 0;
+	std::vector<Timer> fired;
+	for (int tick = start + 1; tick < start + (int)expected.size(); tick++)
+	{
+		fired.clear();
+		wheel.advance(tick, fired);
+		errors += (int)fired.size() != expected[tick - start];
+		for (const Timer& timer : fired)
+		{
+			errors += timer.due != tick;
+		}
+	}
+	errors += wheel.size() != 0;
+	std::cout << "TimerWheel mismatches: " << errors << " == 0" << std::endl;
+}
\ No newline at end of file
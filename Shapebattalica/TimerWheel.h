@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Entity.h"
+#include <cstdint>
+#include <vector>
+
+// Something due to happen on a given tick
+struct Timer
+{
+	enum Kind : uint8_t { Lifespan, EnemySpawn, SpecialReady };
+
+	int due = 0;   // the tick it's for
+	Kind kind = Lifespan;
+	Entity entity; // whose lifespan ends, unused by the game's own timers
+};
+
+// Hierarchical timing wheel. Timers are filed by how far off they are: level 0 has a slot
+// per tick for the next 256 ticks, level 1 a slot per 256 ticks for the next 65536, and so on.
+// Advancing a tick only empties that tick's slot, and every 256 ticks refiles one slot of
+// the level above, so the cost follows the timers that go off rather than the ones waiting.
+//
+// Each slot is a list threaded through one pool of nodes, and gone off timers' nodes are
+// reused, so once the pool is big enough for every timer waiting at once nothing allocates.
+//
+// Timers can't be cancelled. Whoever set one checks it still applies when it goes off,
+// e.g. that the entity is alive and its lifespan still ends on that tick.
+class TimerWheel
+{
+	static constexpr int SLOT_BITS = 8;
+	static constexpr int SLOTS = 1 << SLOT_BITS;
+	static constexpr int SLOT_MASK = SLOTS - 1;
+	static constexpr int LEVELS = 4; // 2^32 ticks, every tick an int can hold
+	static constexpr uint32_t NONE = 0xFFFFFFFF;
+
+	struct Node
+	{
+		Timer timer;
+		uint32_t next = NONE;
+	};
+
+	std::vector<Node> m_nodes;
+	uint32_t m_free = NONE;               // first unused node
+	uint32_t m_slots[LEVELS][SLOTS] = {}; // first node in each slot
+	int m_now = 0; // every timer due on or before this tick has gone off
+	size_t m_count = 0;
+
+	// Files a timer due after now, at the lowest level whose slots still tell now and due apart
+	void file(uint32_t node, int now);
+
+public:
+	TimerWheel();
+
+	// Room for this many timers waiting at once
+	void reserve(size_t timers) { m_nodes.reserve(timers); }
+
+	// Drops every timer and starts counting from now
+	void reset(int now);
+
+	// Timers due on or before the current tick go off on the next advance
+	void schedule(int due, Timer::Kind kind, Entity entity = Entity());
+
+	// Moves on to tick, appending every timer due by then to fired, in no particular order
+	void advance(int tick, std::vector<Timer>& fired);
+
+	int now() const { return m_now; }
+	size_t size() const { return m_count; }
+
+	static void test();
+};
\ No newline at end of file
@@ -2,77 +2,14 @@
 #include <math.h>
 #include <iostream>
 
-Vec2::Vec2()
-{
-
-}
-
-Vec2::Vec2(float xin, float yin) 
-	: x(xin), y(yin) { }
-
-bool Vec2::operator == (const Vec2& rhs) const
-{
-	return (x == rhs.x && y == rhs.y);
-}
-
-bool Vec2::operator != (const Vec2& rhs) const
-{
-	return !(x == rhs.x && y == rhs.y);
-}
-
-Vec2 Vec2::operator + (const Vec2& rhs) const
-{
-	return Vec2(x + rhs.x, y + rhs.y);
-}
-
-Vec2 Vec2::operator - (const Vec2& rhs) const
-{
-	return Vec2(x - rhs.x, y - rhs.y);
-}
-
-Vec2 Vec2::operator * (const float val) const
-{
-	return Vec2(x * val, y * val);
-}
-
-Vec2 Vec2::operator / (const float val) const
-{
-	return Vec2(x / val, y / val);
-}
-
-void Vec2::operator += (const Vec2& rhs)
-{
-	x += rhs.x;
-	y += rhs.y;
-}
-void Vec2::operator -= (const Vec2& rhs)
-{
-	x -= rhs.x;
-	y -= rhs.y;
-}
-
-void Vec2::operator *= (const float val)
-{
-	x *= val;
-	y *= val;
-}
-
-void Vec2::operator /= (const float val)
-{
-	x /= val;
-	y /= val;
-}
-
-
 float Vec2::dist(const Vec2& rhs) const
 {
-    Vec2 dVec = *this - rhs;
-    return std::sqrtf((dVec.x * dVec.x) + (dVec.y * dVec.y));
+    return sqrtf(distSq(rhs));
 }
 
 float Vec2::length() const
 {
-	return std::sqrtf((x * x) + (y * y));
+	return sqrtf(lengthSq());
 }
 
 void Vec2::normalize()
@@ -84,7 +21,7 @@ void Vec2::normalize()
 // Will have rounding issues, keep an eye on it.
 Vec2 Vec2::fromAngleAndSpeed(float angle, float speed)
 {
-    return Vec2(speed * std::cosf(angle), speed * std::sinf(angle));
+    return Vec2(speed * cosf(angle), speed * sinf(angle));
 }
 
 void Vec2::test()
@@ -127,6 +64,9 @@ void Vec2::test()
     // Test dist
     float dist = Vec2(0, 0).dist(Vec2(3, 4));
     std::cout << dist << " == " << 5 << std::endl;
+    // Test distSq
+    std::cout << Vec2(0, 0).distSq(Vec2(3, 4)) << " == " << 25 << std::endl;
+    static_assert(Vec2(1, 2).distSq(Vec2(4, 6)) == 25, "distSq should work at compile time");
     // Test length
     std::cout << v1.length() << " ~= " << 141.42 << std::endl;
     // Test normalize
@@ -1,26 +1,32 @@
 #pragma once
 
+// Small value type, the arithmetic lives here so it inlines and can be used in constant expressions
 class Vec2
 {
 public:
 	float x = 0;
 	float y = 0;
 
-	Vec2();
-	Vec2(float xin, float yin);
+	constexpr Vec2() {}
+	constexpr Vec2(float xin, float yin)
+		: x(xin), y(yin) { }
 
-	bool operator == (const Vec2& rhs) const;
-	bool operator != (const Vec2& rhs) const;
+	constexpr bool operator == (const Vec2& rhs) const { return (x == rhs.x && y == rhs.y); }
+	constexpr bool operator != (const Vec2& rhs) const { return !(x == rhs.x && y == rhs.y); }
 
-	Vec2 operator + (const Vec2& rhs) const;
-	Vec2 operator - (const Vec2& rhs) const;
-	Vec2 operator * (const float val) const;
-	Vec2 operator / (const float val) const;
+	constexpr Vec2 operator + (const Vec2& rhs) const { return Vec2(x + rhs.x, y + rhs.y); }
+	constexpr Vec2 operator - (const Vec2& rhs) const { return Vec2(x - rhs.x, y - rhs.y); }
+	constexpr Vec2 operator * (const float val) const { return Vec2(x * val, y * val); }
+	constexpr Vec2 operator / (const float val) const { return Vec2(x / val, y / val); }
 
-	void operator += (const Vec2& rhs);
-	void operator -= (const Vec2& rhs);
-	void operator *= (const float val);
-	void operator /= (const float val);
+	constexpr void operator += (const Vec2& rhs) { x += rhs.x; y += rhs.y; }
+	constexpr void operator -= (const Vec2& rhs) { x -= rhs.x; y -= rhs.y; }
+	constexpr void operator *= (const float val) { x *= val; y *= val; }
+	constexpr void operator /= (const float val) { x /= val; y /= val; }
+
+	// Squared versions skip the square root, compare them against squared distances
+	constexpr float lengthSq() const { return (x * x) + (y * y); }
+	constexpr float distSq(const Vec2& rhs) const { return (*this - rhs).lengthSq(); }
 
 	float dist(const Vec2& rhs) const;
 	float length() const;
@@ -1,12 +1,137 @@
 #include <SFML/Graphics.hpp>
 #include <iostream>
+#include <string>
+#include <cctype>
 #include "Game.h"
+#include "Benchmark.h"
+#include "MovementKernel.h"
+#include "Narrowphase.h"
+#include "TimerWheel.h"
 
 
-int main() {
-    Vec2::test();
+int main(int argc, char* argv[]) {
+    // Shapebattalica [--config <path>] [--headless [ticks]] [--seed <n>] [--record <log> | --replay <log>] [--trace <trace.json>]
+    //                [--snapshot <world.sbsn>] [--save-snapshot <world.sbsn>]
+    //                [--load <nearest|random|score> [--fire-rate <shots/s>] [--no-specials] [--spawn-multiplier <x>] [--ramp <x>]
+    //                 [--levels <n>] [--level-ticks <n>] [--load-report <report.json>]]
+    // Shapebattalica --bench <systems|collision|iteration|all> [--out <results.json>] [--max-entities <n>]
+    // Shapebattalica --selftest
+    std::string config = "config.txt";
+    std::string bench, benchOutput = "benchmark.json";
+    size_t maxEntities = 1000000;
+    bool selfTest = false;
+    LaunchOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc)
+        {
+            config = argv[++i];
+        }
+        else if (arg == "--bench" && i + 1 < argc)
+        {
+            bench = argv[++i];
+        }
+        else if (arg == "--out" && i + 1 < argc)
+        {
+            benchOutput = argv[++i];
+        }
+        else if (arg == "--max-entities" && i + 1 < argc)
+        {
+            maxEntities = std::stoul(argv[++i]);
+        }
+        else if (arg == "--selftest")
+        {
+            selfTest = true;
+        }
+        else if (arg == "--headless")
+        {
+            options.headless = true;
+            if (i + 1 < argc && std::isdigit((unsigned char)argv[i + 1][0]))
+            {
+                options.ticks = std::stol(argv[++i]);
+            }
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            options.seed = std::stoull(argv[++i]);
+        }
+        else if (arg == "--record" && i + 1 < argc)
+        {
+            options.record = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            options.replay = argv[++i];
+        }
+        else if (arg == "--trace" && i + 1 < argc)
+        {
+            options.trace = argv[++i];
+        }
+        else if (arg == "--snapshot" && i + 1 < argc)
+        {
+            options.snapshot = argv[++i];
+        }
+        else if (arg == "--save-snapshot" && i + 1 < argc)
+        {
+            options.saveSnapshot = argv[++i];
+        }
+        else if (arg == "--load" && i + 1 < argc)
+        {
+            options.load.target = argv[++i];
+        }
+        else if (arg == "--fire-rate" && i + 1 < argc)
+        {
+            options.load.fireRate = std::stof(argv[++i]);
+        }
+        else if (arg == "--no-specials")
+        {
+            options.load.specials = false;
+        }
+        else if (arg == "--spawn-multiplier" && i + 1 < argc)
+        {
+            options.load.spawnMultiplier = std::stof(argv[++i]);
+        }
+        else if (arg == "--ramp" && i + 1 < argc)
+        {
+            options.load.ramp = std::stof(argv[++i]);
+        }
+        else if (arg == "--levels" && i + 1 < argc)
+        {
+            options.load.levels = std::stoi(argv[++i]);
+        }
+        else if (arg == "--level-ticks" && i + 1 < argc)
+        {
+            options.load.levelTicks = std::stoi(argv[++i]);
+        }
+        else if (arg == "--load-report" && i + 1 < argc)
+        {
+            options.load.report = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
 
-    Game g("config.txt");
+    if (!bench.empty())
+    {
+        Benchmark benchmark(config, maxEntities);
+        return benchmark.run(bench, benchOutput) ? 0 : 1;
+    }
+
+    if (selfTest)
+    {
+        Vec2::test();
+        MovementKernel::test();
+        Narrowphase::test();
+        EntityManager::test();
+        TimerWheel::test();
+        return 0;
+    }
+
+    Game g(config, options);
     g.run();
 
 	return 0;